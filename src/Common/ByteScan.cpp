@@ -0,0 +1,267 @@
+#include "ByteScan.hpp"
+#include <cstdint> // std::uint64_t
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define BYTESCAN_X86
+	#include <immintrin.h>
+#endif
+
+struct ScanKernels {
+	const char* (*find)    (const char*, const char*, char);
+	std::size_t (*count)   (const char*, const char*, char);
+	const char* (*graph)   (const char*, const char*);
+	const char* (*nongraph)(const char*, const char*);
+	const char* (*rgraph)  (const char*, const char*);
+};
+
+
+
+/* Scalar */
+
+inline bool inl_isgraph(char c) {
+	unsigned char u = static_cast<unsigned char>(c);
+	return u > 0x20 && u < 0x7F;
+}
+
+inline const char* find_scalar(const char *begin, const char *end, char c) {
+	while (begin < end && *begin != c) begin++;
+	return begin;
+}
+
+inline std::size_t count_scalar(const char *begin, const char *end, char c) {
+	std::size_t count = 0;
+	for (; begin < end; begin++) count += *begin == c;
+	return count;
+}
+
+inline const char* graph_scalar(const char *begin, const char *end) {
+	while (begin < end && !inl_isgraph(*begin)) begin++;
+	return begin;
+}
+
+inline const char* nongraph_scalar(const char *begin, const char *end) {
+	while (begin < end && inl_isgraph(*begin)) begin++;
+	return begin;
+}
+
+inline const char* rgraph_scalar(const char *begin, const char *end) {
+	while (end > begin && !inl_isgraph(end[-1])) end--;
+	return end;
+}
+
+
+
+#ifdef BYTESCAN_X86
+
+/* SSE2 */
+
+__attribute__((target("sse2")))
+inline unsigned inl_graph_mask16(const char *pos) {
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+	__m128i g = _mm_and_si128(
+		_mm_cmpgt_epi8(v, _mm_set1_epi8(0x20)),
+		_mm_cmplt_epi8(v, _mm_set1_epi8(0x7F))
+	);
+	return static_cast<unsigned>(_mm_movemask_epi8(g));
+}
+
+__attribute__((target("sse2")))
+inline const char* find_sse2(const char *begin, const char *end, char c) {
+	__m128i n = _mm_set1_epi8(c);
+	for (; end - begin >= 16; begin += 16) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+		unsigned m = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, n)));
+		if (m) return begin + __builtin_ctz(m);
+	}
+	return find_scalar(begin, end, c);
+}
+
+__attribute__((target("sse2")))
+inline std::size_t count_sse2(const char *begin, const char *end, char c) {
+	__m128i n = _mm_set1_epi8(c);
+	std::size_t count = 0;
+	while (end - begin >= 16) {
+		
+		/* Byte counters overflow after 255 blocks */
+		__m128i sum = _mm_setzero_si128();
+		for (int i = 0; i < 255 && end - begin >= 16; i++, begin += 16) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+			sum = _mm_sub_epi8(sum, _mm_cmpeq_epi8(v, n));
+		}
+		
+		std::uint64_t part[2];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(part), _mm_sad_epu8(sum, _mm_setzero_si128()));
+		count += part[0] + part[1];
+		
+	}
+	return count + count_scalar(begin, end, c);
+}
+
+__attribute__((target("sse2")))
+inline const char* graph_sse2(const char *begin, const char *end) {
+	for (; end - begin >= 16; begin += 16) {
+		unsigned m = inl_graph_mask16(begin);
+		if (m) return begin + __builtin_ctz(m);
+	}
+	return graph_scalar(begin, end);
+}
+
+__attribute__((target("sse2")))
+inline const char* nongraph_sse2(const char *begin, const char *end) {
+	for (; end - begin >= 16; begin += 16) {
+		unsigned m = inl_graph_mask16(begin) ^ 0xFFFF;
+		if (m) return begin + __builtin_ctz(m);
+	}
+	return nongraph_scalar(begin, end);
+}
+
+__attribute__((target("sse2")))
+inline const char* rgraph_sse2(const char *begin, const char *end) {
+	for (; end - begin >= 16; end -= 16) {
+		unsigned m = inl_graph_mask16(end - 16);
+		if (m) return end - __builtin_clz(m) + 16;
+	}
+	return rgraph_scalar(begin, end);
+}
+
+
+
+/* AVX2 */
+
+__attribute__((target("avx2")))
+inline unsigned inl_graph_mask32(const char *pos) {
+	__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+	__m256i g = _mm256_and_si256(
+		_mm256_cmpgt_epi8(v, _mm256_set1_epi8(0x20)),
+		_mm256_cmpgt_epi8(_mm256_set1_epi8(0x7F), v)
+	);
+	return static_cast<unsigned>(_mm256_movemask_epi8(g));
+}
+
+__attribute__((target("avx2")))
+inline const char* find_avx2(const char *begin, const char *end, char c) {
+	__m256i n = _mm256_set1_epi8(c);
+	for (; end - begin >= 32; begin += 32) {
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+		unsigned m = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, n)));
+		if (m) return begin + __builtin_ctz(m);
+	}
+	return find_sse2(begin, end, c);
+}
+
+__attribute__((target("avx2")))
+inline std::size_t count_avx2(const char *begin, const char *end, char c) {
+	__m256i n = _mm256_set1_epi8(c);
+	std::size_t count = 0;
+	while (end - begin >= 32) {
+		
+		/* Byte counters overflow after 255 blocks */
+		__m256i sum = _mm256_setzero_si256();
+		for (int i = 0; i < 255 && end - begin >= 32; i++, begin += 32) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+			sum = _mm256_sub_epi8(sum, _mm256_cmpeq_epi8(v, n));
+		}
+		
+		std::uint64_t part[4];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(part), _mm256_sad_epu8(sum, _mm256_setzero_si256()));
+		count += part[0] + part[1] + part[2] + part[3];
+		
+	}
+	return count + count_sse2(begin, end, c);
+}
+
+__attribute__((target("avx2")))
+inline const char* graph_avx2(const char *begin, const char *end) {
+	for (; end - begin >= 32; begin += 32) {
+		unsigned m = inl_graph_mask32(begin);
+		if (m) return begin + __builtin_ctz(m);
+	}
+	return graph_sse2(begin, end);
+}
+
+__attribute__((target("avx2")))
+inline const char* nongraph_avx2(const char *begin, const char *end) {
+	for (; end - begin >= 32; begin += 32) {
+		unsigned m = ~inl_graph_mask32(begin);
+		if (m) return begin + __builtin_ctz(m);
+	}
+	return nongraph_sse2(begin, end);
+}
+
+__attribute__((target("avx2")))
+inline const char* rgraph_avx2(const char *begin, const char *end) {
+	for (; end - begin >= 32; end -= 32) {
+		unsigned m = inl_graph_mask32(end - 32);
+		if (m) return end - __builtin_clz(m);
+	}
+	return rgraph_sse2(begin, end);
+}
+
+#endif // BYTESCAN_X86
+
+
+
+/* Dispatch */
+
+static const ScanKernels scan_kernels[] = {
+	{ find_scalar, count_scalar, graph_scalar, nongraph_scalar, rgraph_scalar },
+#ifdef BYTESCAN_X86
+	{ find_sse2,   count_sse2,   graph_sse2,   nongraph_sse2,   rgraph_sse2   },
+	{ find_avx2,   count_avx2,   graph_avx2,   nongraph_avx2,   rgraph_avx2   }
+#endif
+};
+
+inline ScanLevel inl_detect() {
+#ifdef BYTESCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return SCAN_AVX2;
+	if (__builtin_cpu_supports("sse2")) return SCAN_SSE2;
+#endif
+	return SCAN_SCALAR;
+}
+
+/* Zero initialized to SCAN_SCALAR until detection runs */
+static ScanLevel scan_level = inl_detect();
+static const ScanLevel scan_supported = inl_detect();
+
+const char* scanByte(const char *begin, const char *end, char c)
+{
+	return scan_kernels[scan_level].find(begin, end, c);
+}
+
+std::size_t countByte(const char *begin, const char *end, char c)
+{
+	return scan_kernels[scan_level].count(begin, end, c);
+}
+
+const char* scanGraph(const char *begin, const char *end)
+{
+	return scan_kernels[scan_level].graph(begin, end);
+}
+
+const char* scanNonGraph(const char *begin, const char *end)
+{
+	return scan_kernels[scan_level].nongraph(begin, end);
+}
+
+const char* scanGraphReverse(const char *begin, const char *end)
+{
+	return scan_kernels[scan_level].rgraph(begin, end);
+}
+
+ScanLevel getScanLevel()
+{
+	return scan_level;
+}
+
+bool setScanLevel(ScanLevel level)
+{
+	if (!isScanLevelSupported(level)) return false;
+	scan_level = level;
+	return true;
+}
+
+bool isScanLevelSupported(ScanLevel level)
+{
+	return level <= scan_supported;
+}
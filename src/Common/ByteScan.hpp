@@ -0,0 +1,38 @@
+#pragma once
+#ifndef _BYTESCAN_HPP_
+#define _BYTESCAN_HPP_
+
+#include <cstddef> // std::size_t
+
+/* Byte scanning over [begin, end), vectorized where the CPU allows it.
+ * Graph characters are the ASCII range '!' to '~', as std::isgraph in the
+ * "C" locale. */
+
+enum ScanLevel {
+	SCAN_SCALAR,
+	SCAN_SSE2,
+	SCAN_AVX2
+};
+
+/* First c, or end */
+const char* scanByte(const char *begin, const char *end, char c);
+
+/* Number of c */
+std::size_t countByte(const char *begin, const char *end, char c);
+
+/* First graph character, or end */
+const char* scanGraph(const char *begin, const char *end);
+
+/* First non graph character, or end */
+const char* scanNonGraph(const char *begin, const char *end);
+
+/* One past the last graph character, or begin */
+const char* scanGraphReverse(const char *begin, const char *end);
+
+/* Best supported level is picked at startup, setScanLevel() returns false
+ * if the CPU doesn't support the level. Not safe while other threads scan. */
+ScanLevel getScanLevel();
+bool setScanLevel(ScanLevel level);
+bool isScanLevelSupported(ScanLevel level);
+
+#endif // _BYTESCAN_HPP_
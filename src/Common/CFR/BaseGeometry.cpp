@@ -1,50 +1,206 @@
 #include "BaseGeometry.hpp"
+#include <thread>
+#include <exception> // std::exception_ptr
+#include <system_error> // std::system_error
+#include <algorithm> // std::fill, std::max, std::sort
+#include <utility> // std::swap
+#include <cstring> // std::memcmp, std::memcpy
 
 using CFR::BaseGeometry;
 using CFR::size_type;
 using CFR::Uint8;
 using CFR::Uint16;
 using CFR::Uint32;
+using CFR::Uint64;
 using CFR::Vertex;
+using CFR::Meshlet;
+using CFR::RecalculateMode;
+using CFR::VertexStorage;
+
+/* Vertex lookup table */
+static const Uint32    tableEmpty   = 0xFFFFFFFF;
+static const size_type tableMinimum = 16;
+static const float     tableMaxLoad = 0.5f;
+
+/* Largest packed vertex, 12 components of 4 bytes */
+static const size_type packedMaximum = 48;
+
+/* Fibonacci hashing, spreads std::hash<Vertex> over the table by its high bits */
+inline size_type tableSlot(const Vertex &v, unsigned shift) {
+	Uint64 hash = static_cast<Uint64>(std::hash<Vertex>()(v)) * 0x9E3779B97F4A7C15ull;
+	return static_cast<size_type>(hash >> shift);
+}
+
+/* Run fn(thread, begin, end) over count items split between threads.
+ * Slices without a thread run on this one, errors are rethrown after the join. */
+template<typename F>
+inline void inl_parallel(unsigned threads, size_type count, F fn) {
+	if (threads < 1) threads = 1;
+	std::vector<std::exception_ptr> errors(threads);
+	auto slice = [&](unsigned t) {
+		try {
+			fn(t, count * t / threads, count * (t + 1) / threads);
+		} catch (...) {
+			errors[t] = std::current_exception();
+		}
+	};
+	std::vector<std::thread> workers;
+	workers.reserve(threads);
+	unsigned started = 1;
+	try {
+		for (; started < threads; started++) workers.push_back(std::thread(slice, started));
+	} catch (std::system_error&) {}
+	for (unsigned t = started; t < threads; t++) slice(t);
+	slice(0);
+	for (std::size_t t = 0; t < workers.size(); t++) workers[t].join();
+	for (const std::exception_ptr &error : errors) {
+		if (error) std::rethrow_exception(error);
+	}
+}
+
+/* 32 bits of vertex hash and the position in first use order */
+struct WeldKey {
+	Uint32 hash;
+	Uint32 index;
+};
+
+/* Stable LSD radix sort by hash, 16 bits per pass */
+inline void inl_radixSort(std::vector<WeldKey> &keys, unsigned threads) {
+	static const unsigned digits = 1 << 16;
+	std::vector<WeldKey> buffer(keys.size());
+	std::vector<Uint32> offsets(threads * digits);
+	for (unsigned shift = 0; shift < 32; shift += 16) {
+		
+		/* Digit counts per thread slice */
+		std::fill(offsets.begin(), offsets.end(), 0);
+		inl_parallel(threads, keys.size(), [&](unsigned t, size_type begin, size_type end) {
+			Uint32 *count = &offsets[t * digits];
+			for (size_type i = begin; i < end; i++) count[(keys[i].hash >> shift) & 0xFFFF]++;
+		});
+		
+		/* Slices scatter in order, so equal digits keep their order */
+		Uint32 sum = 0;
+		for (unsigned d = 0; d < digits; d++) {
+			for (unsigned t = 0; t < threads; t++) {
+				Uint32 count = offsets[t * digits + d];
+				offsets[t * digits + d] = sum;
+				sum += count;
+			}
+		}
+		inl_parallel(threads, keys.size(), [&](unsigned t, size_type begin, size_type end) {
+			Uint32 *offset = &offsets[t * digits];
+			for (size_type i = begin; i < end; i++) buffer[offset[(keys[i].hash >> shift) & 0xFFFF]++] = keys[i];
+		});
+		keys.swap(buffer);
+		
+	}
+}
 
 BaseGeometry::BaseGeometry()
-: elementMax(0)
+: storage(STORAGE_FULL), packedStride(0), packedCount(0),
+  elementMax(0), tableUsed(0), tableShift(64), tableLookups(0), tableProbes(0),
+  tableLive(false), tableReserve(0)
 {}
 
 BaseGeometry::BaseGeometry(const BaseGeometry &copy)
-: vertices(copy.vertices), vertexElements(copy.vertexElements), 
-  elements(copy.elements), elementMax(copy.elementMax)
-{}
+: vertices(copy.vertices), storage(STORAGE_FULL), packedStride(0), packedCount(0),
+  elements(copy.elements), elementMax(copy.elementMax),
+  meshlets(copy.meshlets), meshletVertices(copy.meshletVertices), meshletTriangles(copy.meshletTriangles),
+  table(copy.table), tableUsed(copy.tableUsed), tableShift(copy.tableShift),
+  tableLookups(copy.tableLookups), tableProbes(copy.tableProbes),
+  tableLive(copy.tableLive), tableReserve(copy.tableReserve)
+{
+	/* The packed layout belongs to the copied object, decode */
+	if (copy.storage == STORAGE_PACKED) {
+		vertices.resize(copy.packedCount);
+		for (size_type i = 0; i < copy.packedCount; i++) vertices[i] = copy.getVertex(i);
+	}
+}
 
 void BaseGeometry::addElement(Uint32 element)
 {
-	if (element >= vertices.size()) {
+	if (element >= getVertexCount()) {
 		throw Exception("Element out of range.");
 	}
 	elements.push_back(element);
 	if (elementMax < element) elementMax = element;
 }
 
+void BaseGeometry::setElement(size_type index, Uint32 element)
+{
+	if (index >= elements.size() || element >= getVertexCount()) {
+		throw Exception("Element out of range.");
+	}
+	elements[index] = element;
+	if (elementMax < element) elementMax = element;
+}
+
 Uint32 BaseGeometry::pushVertex(const Vertex &v)
 {
-	Uint32 index = static_cast<Uint32>(vertices.size());
-	vertexElements[v] = index;
-	vertices.push_back(v);
+	/* Without a table there is nothing to keep up to date */
+	if (!tableLive) {
+		Uint32 index = static_cast<Uint32>(getVertexCount());
+		appendVertex(v);
+		return index;
+	}
+	tableResize(tableUsed + 1);
+	Uint32 *slot = tableFind(v);
+	if (*slot == tableEmpty) tableUsed++;
+	Uint32 index = static_cast<Uint32>(getVertexCount());
+	appendVertex(v);
+	*slot = index;
 	return index;
 }
 
 Uint32 BaseGeometry::addVertex(const Vertex &v)
 {
-	std::unordered_map<Vertex, Uint32>::iterator i
-		= vertexElements.find(v);
-	if (i != vertexElements.end()) return i->second;
-	return pushVertex(v);
+	if (!tableLive) tableBuild();
+	tableResize(tableUsed + 1);
+	Uint32 *slot = tableFind(v);
+	if (*slot != tableEmpty) return *slot;
+	tableUsed++;
+	Uint32 index = static_cast<Uint32>(getVertexCount());
+	appendVertex(v);
+	*slot = index;
+	return index;
+}
+
+void BaseGeometry::addMeshlet(Meshlet meshlet, const Uint32 *vertices, const Uint8 *triangles)
+{
+	if (meshlet.vertexCount > 256) {
+		throw Exception("Too many meshlet vertices.");
+	} else if (meshlet.elementOffset + meshlet.triangleCount * size_type(3) > elements.size()) {
+		throw Exception("Meshlet elements out of range.");
+	}
+	for (Uint32 i = 0; i < meshlet.vertexCount; i++) {
+		if (vertices[i] >= getVertexCount()) throw Exception("Meshlet vertex out of range.");
+	}
+	for (Uint32 i = 0; i < meshlet.triangleCount * 3; i++) {
+		if (triangles[i] >= meshlet.vertexCount) throw Exception("Meshlet triangle out of range.");
+	}
+	meshlet.vertexOffset   = static_cast<Uint32>(meshletVertices.size());
+	meshlet.triangleOffset = static_cast<Uint32>(meshletTriangles.size() / 3);
+	meshletVertices.insert(meshletVertices.end(), vertices, vertices + meshlet.vertexCount);
+	meshletTriangles.insert(meshletTriangles.end(), triangles, triangles + meshlet.triangleCount * 3);
+	meshlets.push_back(meshlet);
+}
+
+void BaseGeometry::clearMeshlets()
+{
+	meshlets.clear();
+	meshletVertices.clear();
+	meshletTriangles.clear();
 }
 
 void BaseGeometry::reserveVertices(size_type count)
 {
-	vertexElements.reserve(count);
-	vertices.reserve(count);
+	tableReserve = count;
+	if (tableLive) tableResize(count);
+	if (storage == STORAGE_PACKED) {
+		packed.reserve(count * packedStride);
+	} else {
+		vertices.reserve(count);
+	}
 }
 
 void BaseGeometry::reserveElements(size_type count)
@@ -57,29 +213,215 @@ void BaseGeometry::clear()
 	elements.clear();
 	elementMax = 0;
 	vertices.clear();
-	vertexElements.clear();
+	packed.clear();
+	packedCount = 0;
+	clearMeshlets();
+	tableDrop();
+	tableReserve = 0;
+	tableLookups = 0;
+	tableProbes  = 0;
 }
 
 void BaseGeometry::recalculate()
 {
-	std::vector<Vertex> vertexCopy (vertices);
-	std::vector<Uint32> elementCopy(elements);
-	clear();
-	reserveVertices(vertexCopy.size());
-	reserveElements(elementCopy.size());
-	for (std::size_t i = 0; i < elementCopy.size(); i++) {
-		addElement(addVertex(vertexCopy[elementCopy[i]]));
+	recalculate(RECALCULATE_HASH);
+}
+
+void BaseGeometry::recalculate(RecalculateMode mode, unsigned threads)
+{
+	/* Old to new index, and whether the vertex is the first of its kind */
+	std::vector<Uint32> remap(getVertexCount(), tableEmpty);
+	std::vector<bool>   keep (getVertexCount(), false);
+	Uint32 count = mode == RECALCULATE_SORT
+		? recalculateSort(remap, keep, threads > 0 ? threads : 1)
+		: recalculateHash(remap, keep);
+		
+	/* Move kept vertices to their new index */
+	permuteVertices(remap, keep);
+	if (storage == STORAGE_PACKED) {
+		packed.resize(count * packedStride);
+		packedCount = count;
+	} else {
+		vertices.resize(count);
+	}
+	
+	/* Indices changed, addVertex() builds the table again */
+	tableDrop();
+}
+
+void BaseGeometry::reorderVertices()
+{
+	/* Old to new index, used vertices first */
+	std::vector<Uint32> remap(getVertexCount(), tableEmpty);
+	Uint32 count = 0;
+	elementMax = 0;
+	for (std::size_t i = 0; i < elements.size(); i++) {
+		Uint32 old = elements[i];
+		if (remap[old] == tableEmpty) remap[old] = count++;
+		elements[i] = remap[old];
+		if (elementMax < elements[i]) elementMax = elements[i];
+	}
+	for (std::size_t i = 0; i < getVertexCount(); i++) {
+		if (remap[i] == tableEmpty) remap[i] = count++;
+	}
+	
+	/* Every vertex moves, slots don't depend on the index */
+	std::vector<bool> move(getVertexCount(), true);
+	permuteVertices(remap, move);
+	for (std::size_t i = 0; i < table.size(); i++) {
+		if (table[i] != tableEmpty) table[i] = remap[table[i]];
 	}
 }
 
+void BaseGeometry::permuteVertices(const std::vector<Uint32> &remap, std::vector<bool> &move)
+{
+	/* Move marked vertices to remap[i], following permutation cycles */
+	if (storage == STORAGE_PACKED) {
+		std::vector<Uint8> carry(packedStride);
+		for (std::size_t i = 0; i < packedCount; i++) {
+			if (!move[i]) continue;
+			move[i] = false;
+			std::memcpy(carry.data(), &packed[i * packedStride], packedStride);
+			Uint32 next = remap[i];
+			while (move[next]) {
+				move[next] = false;
+				std::swap_ranges(carry.begin(), carry.end(), packed.begin() + next * packedStride);
+				next = remap[next];
+			}
+			std::memcpy(&packed[next * packedStride], carry.data(), packedStride);
+		}
+	} else {
+		for (std::size_t i = 0; i < vertices.size(); i++) {
+			if (!move[i]) continue;
+			move[i] = false;
+			Vertex carry = vertices[i];
+			Uint32 next = remap[i];
+			while (move[next]) {
+				move[next] = false;
+				std::swap(carry, vertices[next]);
+				next = remap[next];
+			}
+			vertices[next] = carry;
+		}
+	}
+	
+	/* Meshlets follow their vertices */
+	for (std::size_t i = 0; i < meshletVertices.size(); i++) {
+		meshletVertices[i] = remap[meshletVertices[i]];
+	}
+}
+
+Uint32 BaseGeometry::recalculateHash(std::vector<Uint32> &remap, std::vector<bool> &keep)
+{
+	/* Number vertices by first use, the table holds old indices meanwhile */
+	std::fill(table.begin(), table.end(), tableEmpty);
+	tableUsed  = 0;
+	tableResize(getVertexCount());
+	elementMax = 0;
+	Uint32 count = 0;
+	for (std::size_t i = 0; i < elements.size(); i++) {
+		Uint32 old = elements[i];
+		if (remap[old] == tableEmpty) {
+			Vertex vertex = compressVertex(getVertex(old));
+			storeVertex(old, vertex);
+			Uint32 *slot = tableFind(vertex);
+			if (*slot == tableEmpty) {
+				*slot = old;
+				tableUsed++;
+				keep[old]  = true;
+				remap[old] = count++;
+			} else {
+				remap[old] = remap[*slot];
+			}
+		}
+		elements[i] = remap[old];
+		if (elementMax < elements[i]) elementMax = elements[i];
+	}
+	return count;
+}
+
+Uint32 BaseGeometry::recalculateSort(std::vector<Uint32> &remap, std::vector<bool> &keep, unsigned threads)
+{
+	/* Used vertices in first use order, remap holds the position meanwhile */
+	std::vector<Uint32> order;
+	for (std::size_t i = 0; i < elements.size(); i++) {
+		Uint32 old = elements[i];
+		if (remap[old] != tableEmpty) continue;
+		remap[old] = static_cast<Uint32>(order.size());
+		order.push_back(old);
+	}
+	
+	/* Compress and hash */
+	std::vector<WeldKey> keys(order.size());
+	inl_parallel(threads, order.size(), [&](unsigned, size_type begin, size_type end) {
+		for (size_type i = begin; i < end; i++) {
+			Vertex vertex = compressVertex(getVertex(order[i]));
+			storeVertex(order[i], vertex);
+			keys[i].hash  = static_cast<Uint32>(tableSlot(vertex, 32));
+			keys[i].index = static_cast<Uint32>(i);
+		}
+	});
+	inl_radixSort(keys, threads);
+	
+	/* Runs of equal hashes are sorted by vertex and position, equal vertices are
+	 * then next to each other with the first used one ahead, point each vertex at
+	 * it. Two keys are already in position order. Runs are split between threads
+	 * at run boundaries. */
+	std::vector<Uint32> first(order.size());
+	inl_parallel(threads, keys.size(), [&](unsigned, size_type begin, size_type end) {
+		while (begin > 0 && begin < keys.size() && keys[begin].hash == keys[begin - 1].hash) begin++;
+		while (end   > 0 && end   < keys.size() && keys[end  ].hash == keys[end   - 1].hash) end++;
+		for (size_type run = begin; run < end; ) {
+			size_type stop = run + 1;
+			while (stop < end && keys[stop].hash == keys[run].hash) stop++;
+			if (stop - run > 2) {
+				std::sort(keys.begin() + run, keys.begin() + stop, [&](const WeldKey &a, const WeldKey &b) {
+					int c = compareVertices(order[a.index], order[b.index]);
+					return c != 0 ? c < 0 : a.index < b.index;
+				});
+			}
+			first[keys[run].index] = keys[run].index;
+			for (size_type i = run + 1; i < stop; i++) {
+				Uint32 index = keys[i].index;
+				Uint32 other = keys[i - 1].index;
+				first[index] = equalVertices(order[other], order[index]) ? first[other] : index;
+			}
+			run = stop;
+		}
+	});
+	
+	/* Number in first use order, exactly as addVertex would */
+	Uint32 count = 0;
+	for (std::size_t i = 0; i < order.size(); i++) {
+		if (first[i] == i) {
+			keep[order[i]] = true;
+			first[i] = count++;
+		} else {
+			first[i] = first[first[i]];
+		}
+	}
+	
+	/* Rewrite elements */
+	std::vector<Uint32> maximum(threads, 0);
+	inl_parallel(threads, elements.size(), [&](unsigned t, size_type begin, size_type end) {
+		for (size_type i = begin; i < end; i++) {
+			elements[i] = first[remap[elements[i]]];
+			if (maximum[t] < elements[i]) maximum[t] = elements[i];
+		}
+	});
+	elementMax = *std::max_element(maximum.begin(), maximum.end());
+	for (std::size_t i = 0; i < order.size(); i++) remap[order[i]] = first[i];
+	return count;
+}
+
 bool BaseGeometry::empty() const
 {
-	return vertices.empty() && elements.empty();
+	return getVertexCount() == 0 && elements.empty();
 }
 
 size_type BaseGeometry::getVertexCount() const
 {
-	return vertices.size();
+	return storage == STORAGE_PACKED ? packedCount : vertices.size();
 }
 
 size_type BaseGeometry::getElementCount() const
@@ -92,8 +434,9 @@ Uint32 BaseGeometry::getElementMax() const
 	return elementMax;
 }
 
-const Vertex& BaseGeometry::getVertex(size_type index) const
+Vertex BaseGeometry::getVertex(size_type index) const
 {
+	if (storage == STORAGE_PACKED) return unpackVertex(&packed[index * packedStride]);
 	return vertices[index];
 }
 
@@ -101,3 +444,232 @@ const Uint32& BaseGeometry::getElement(size_type index) const
 {
 	return elements[index];
 }
+
+size_type BaseGeometry::getMeshletCount() const
+{
+	return meshlets.size();
+}
+
+const Meshlet& BaseGeometry::getMeshlet(size_type index) const
+{
+	return meshlets[index];
+}
+
+const Uint32& BaseGeometry::getMeshletVertex(size_type index) const
+{
+	return meshletVertices[index];
+}
+
+const Uint8& BaseGeometry::getMeshletTriangle(size_type index) const
+{
+	return meshletTriangles[index];
+}
+
+size_type BaseGeometry::getTableCapacity() const
+{
+	return table.size();
+}
+
+float BaseGeometry::getTableLoad() const
+{
+	return table.empty() ? 0.f : static_cast<float>(tableUsed) / table.size();
+}
+
+float BaseGeometry::getTableProbes() const
+{
+	return tableLookups == 0 ? 0.f : static_cast<float>(tableProbes) / tableLookups;
+}
+
+Vertex BaseGeometry::compressVertex(Vertex v) const
+{
+	return v;
+}
+
+size_type BaseGeometry::packedSize() const
+{
+	return 0;
+}
+
+void BaseGeometry::packVertex(const Vertex&, Uint8*) const
+{}
+
+Vertex BaseGeometry::unpackVertex(const Uint8*) const
+{
+	return Vertex();
+}
+
+void BaseGeometry::setVertexStorage(VertexStorage storage)
+{
+	if (storage == STORAGE_PACKED) {
+		
+		/* Compress again as the layout may have changed since */
+		size_type stride = packedSize();
+		if (stride == 0 || stride > packedMaximum) {
+			throw Exception("Packed vertex storage not supported.");
+		}
+		std::vector<Vertex> full;
+		if (this->storage == STORAGE_PACKED) {
+			full.resize(packedCount);
+			for (size_type i = 0; i < packedCount; i++) full[i] = getVertex(i);
+		} else {
+			full.swap(vertices);
+		}
+		packedStride = stride;
+		packedCount  = full.size();
+		packed.assign(packedCount * stride, 0);
+		for (size_type i = 0; i < packedCount; i++) packVertex(compressVertex(full[i]), &packed[i * stride]);
+		this->storage = STORAGE_PACKED;
+		
+	} else if (this->storage == STORAGE_PACKED) {
+		
+		vertices.resize(packedCount);
+		for (size_type i = 0; i < packedCount; i++) vertices[i] = getVertex(i);
+		std::vector<Uint8>().swap(packed);
+		packedStride = 0;
+		packedCount  = 0;
+		this->storage = STORAGE_FULL;
+		return;
+		
+	} else {
+		return;
+	}
+	
+	/* Packed values changed with the layout */
+	if (tableLive) tableBuild();
+}
+
+VertexStorage BaseGeometry::getVertexStorage() const
+{
+	return storage;
+}
+
+void BaseGeometry::appendVertex(const Vertex &v)
+{
+	if (storage == STORAGE_PACKED) {
+		packed.resize(packed.size() + packedStride);
+		packVertex(v, &packed[packedCount * packedStride]);
+		packedCount++;
+	} else {
+		vertices.push_back(v);
+	}
+}
+
+void BaseGeometry::storeVertex(size_type index, const Vertex &v)
+{
+	if (storage == STORAGE_PACKED) {
+		packVertex(v, &packed[index * packedStride]);
+	} else {
+		vertices[index] = v;
+	}
+}
+
+bool BaseGeometry::equalVertices(size_type a, size_type b) const
+{
+	if (storage == STORAGE_PACKED) {
+		return std::memcmp(&packed[a * packedStride], &packed[b * packedStride], packedStride) == 0;
+	}
+	return vertices[a] == vertices[b];
+}
+
+int BaseGeometry::compareVertices(size_type a, size_type b) const
+{
+	if (storage == STORAGE_PACKED) {
+		return std::memcmp(&packed[a * packedStride], &packed[b * packedStride], packedStride);
+	}
+	
+	/* The bits operator== compares, in its order */
+	const Vertex &va = vertices[a], &vb = vertices[b];
+	const Uint32 ka[12] = {
+		va.position.packX, va.position.packY, va.position.packZ,
+		va.texcoord.packX, va.texcoord.packY,
+		va.normal.packX,   va.normal.packY,   va.normal.packZ,
+		va.tangent.packX,  va.tangent.packY,  va.tangent.packZ, va.tangent.packW
+	};
+	const Uint32 kb[12] = {
+		vb.position.packX, vb.position.packY, vb.position.packZ,
+		vb.texcoord.packX, vb.texcoord.packY,
+		vb.normal.packX,   vb.normal.packY,   vb.normal.packZ,
+		vb.tangent.packX,  vb.tangent.packY,  vb.tangent.packZ, vb.tangent.packW
+	};
+	for (int i = 0; i < 12; i++) {
+		if (ka[i] != kb[i]) return ka[i] < kb[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+Uint32* BaseGeometry::tableFind(const Vertex &v)
+{
+	size_type mask = table.size() - 1;
+	size_type slot = tableSlot(v, tableShift);
+	tableLookups++;
+	
+	/* Packed vertices compare their bytes */
+	if (storage == STORAGE_PACKED) {
+		Uint8 key[packedMaximum];
+		packVertex(v, key);
+		for (;;) {
+			tableProbes++;
+			Uint32 index = table[slot];
+			if (index == tableEmpty || std::memcmp(&packed[index * packedStride], key, packedStride) == 0) return &table[slot];
+			slot = (slot + 1) & mask;
+		}
+	}
+	
+	for (;;) {
+		tableProbes++;
+		Uint32 index = table[slot];
+		if (index == tableEmpty || vertices[index] == v) return &table[slot];
+		slot = (slot + 1) & mask;
+	}
+}
+
+void BaseGeometry::tableBuild()
+{
+	/* Newest duplicate wins as in pushVertex */
+	size_type count = getVertexCount();
+	std::fill(table.begin(), table.end(), tableEmpty);
+	tableUsed = 0;
+	tableLive = true;
+	tableResize(std::max(count, tableReserve));
+	for (size_type i = 0; i < count; i++) {
+		Uint32 *slot = tableFind(getVertex(i));
+		if (*slot == tableEmpty) tableUsed++;
+		*slot = static_cast<Uint32>(i);
+	}
+}
+
+void BaseGeometry::tableDrop()
+{
+	std::vector<Uint32>().swap(table);
+	tableUsed  = 0;
+	tableShift = 64;
+	tableLive  = false;
+}
+
+void BaseGeometry::tableResize(size_type count)
+{
+	if (count <= table.size() * tableMaxLoad) return;
+	
+	/* Smallest power of two that keeps the load under the limit */
+	size_type capacity = tableMinimum;
+	while (count > capacity * tableMaxLoad) capacity *= 2;
+	unsigned shift = 64;
+	for (size_type c = capacity; c > 1; c >>= 1) shift--;
+	
+	/* Reinsert */
+	std::vector<Uint32> old(capacity, tableEmpty);
+	old.swap(table);
+	tableShift = shift;
+	for (std::size_t i = 0; i < old.size(); i++) {
+		if (old[i] != tableEmpty) tableInsert(old[i]);
+	}
+}
+
+void BaseGeometry::tableInsert(Uint32 index)
+{
+	/* Indices in the table are unique so there is nothing to compare */
+	size_type mask = table.size() - 1;
+	size_type slot = tableSlot(getVertex(index), tableShift);
+	while (table[slot] != tableEmpty) slot = (slot + 1) & mask;
+	table[slot] = index;
+}
@@ -4,12 +4,43 @@
 
 #include "Common.hpp"
 #include <vector>
-#include <unordered_map>
 
 namespace CFR {
 	
 	
 	
+	/* How recalculate() finds duplicate vertices */
+	enum RecalculateMode {
+		RECALCULATE_HASH, // Lookup table, one vertex at a time
+		RECALCULATE_SORT  // Radix sort of vertex hashes, runs on multiple threads
+	};
+	
+	
+	
+	/* How BaseGeometry keeps its vertices */
+	enum VertexStorage {
+		STORAGE_FULL,  // Vertex structs, floats and packed values
+		STORAGE_PACKED // Packed values only at the file stride, floats decoded on demand
+	};
+	
+	
+	
+	/* Cluster of triangles over at most 256 of the geometry's vertices */
+	struct Meshlet {
+		Uint32 vertexOffset   = 0; // First getMeshletVertex()
+		Uint32 vertexCount    = 0;
+		Uint32 triangleOffset = 0; // First triangle, 3 getMeshletTriangle() each
+		Uint32 triangleCount  = 0;
+		Uint32 elementOffset  = 0; // First element of the same triangles
+		Vec3  center;              // Bounding sphere
+		float radius = 0.f;
+		Vec3  apex;                // Normal cone, cutoff 1 if it never culls
+		Vec3  axis;
+		float cutoff = 1.f;
+	};
+	
+	
+	
 	class BaseGeometry {
 	public:
 		
@@ -20,12 +51,23 @@ namespace CFR {
 		/* Add element - throws CFR::Exception */
 		void addElement(Uint32 element);
 		
-		/* Add vertex and return its element */
+		/* Replace element - throws CFR::Exception, getElementMax() doesn't shrink */
+		void setElement(size_type index, Uint32 element);
+		
+		/* Add vertex and return its element. Geometry only filled this way,
+		 * like a loaded file, never builds the lookup table. */
 		virtual Uint32 pushVertex(const Vertex &v);
 		
-		/* Either add or find a similar vertex and return its element */
+		/* Either add or find a similar vertex and return its element,
+		 * the first call builds the lookup table over existing vertices */
 		virtual Uint32 addVertex(const Vertex &v);
 		
+		/* Add meshlet with its vertices and 3 local indices per triangle,
+		 * vertexOffset and triangleOffset are assigned - throws CFR::Exception.
+		 * Vertex renumbering keeps meshlets, element edits don't. */
+		void addMeshlet(Meshlet meshlet, const Uint32 *vertices, const Uint8 *triangles);
+		void clearMeshlets();
+		
 		/* Reserve space */
 		void reserveVertices(size_type count);
 		void reserveElements(size_type count);
@@ -33,24 +75,91 @@ namespace CFR {
 		/* Delete everything */
 		void clear();
 		
-		/* Remove duplicate vertices */
+		/* Remove duplicate and unused vertices in place, keeping first use order.
+		 * Both modes give the same result. */
 		void recalculate();
+		void recalculate(RecalculateMode mode, unsigned threads = 1);
+		
+		/* Renumber vertices by first use in element order for vertex fetch,
+		 * unused vertices move to the end in their old order */
+		void reorderVertices();
+		
+		/* Switch vertex storage, packed storage needs a subclass that packs
+		 * (Geometry) - throws CFR::Exception. Copies always use full storage. */
+		void setVertexStorage(VertexStorage storage);
+		VertexStorage getVertexStorage() const;
 		
 		/* Getters */
 		bool empty() const;
 		size_type getVertexCount()  const;
 		size_type getElementCount() const;
 		Uint32    getElementMax()   const;
-		const Vertex& getVertex (size_type index) const;
+		Vertex        getVertex (size_type index) const;
 		const Uint32& getElement(size_type index) const;
+		size_type getMeshletCount() const;
+		const Meshlet& getMeshlet        (size_type index) const;
+		const Uint32&  getMeshletVertex  (size_type index) const;
+		const Uint8&   getMeshletTriangle(size_type index) const;
+		
+		/* Vertex lookup table statistics */
+		size_type getTableCapacity() const; // Slots
+		float     getTableLoad()     const; // Used slots / slots
+		float     getTableProbes()   const; // Average slots visited per lookup
+		
+	protected:
+		
+		/* Applied to each vertex by recalculate() */
+		virtual Vertex compressVertex(Vertex v) const;
+		
+		/* Packed vertex layout, a size of 0 means packed storage isn't supported */
+		virtual size_type packedSize() const;
+		virtual void   packVertex  (const Vertex &v, Uint8 *out) const;
+		virtual Vertex unpackVertex(const Uint8 *in) const;
 		
 	private:
 		
 		std::vector<Vertex> vertices;
-		std::unordered_map<Vertex, Uint32> vertexElements; 
+		
+		/* Packed storage */
+		VertexStorage      storage;
+		std::vector<Uint8> packed;
+		size_type          packedStride;
+		size_type          packedCount;
+		
 		std::vector<Uint32> elements;
 		Uint32 elementMax;
 		
+		/* Meshlets and their vertex and local index lists */
+		std::vector<Meshlet> meshlets;
+		std::vector<Uint32>  meshletVertices;
+		std::vector<Uint8>   meshletTriangles;
+		
+		/* Open addressing table of vertex indices, linear probing. Built by
+		 * the first addVertex(), dropped when indices change. */
+		std::vector<Uint32> table;
+		size_type tableUsed;
+		unsigned  tableShift;
+		Uint64    tableLookups;
+		Uint64    tableProbes;
+		bool      tableLive;
+		size_type tableReserve;
+		
+		Uint32 recalculateHash(std::vector<Uint32> &remap, std::vector<bool> &keep);
+		Uint32 recalculateSort(std::vector<Uint32> &remap, std::vector<bool> &keep, unsigned threads);
+		void permuteVertices(const std::vector<Uint32> &remap, std::vector<bool> &move);
+		
+		/* Storage independent vertex access */
+		void appendVertex (const Vertex &v);
+		void storeVertex  (size_type index, const Vertex &v);
+		bool equalVertices(size_type a, size_type b) const;
+		int  compareVertices(size_type a, size_type b) const;
+		
+		Uint32* tableFind(const Vertex &v);
+		void tableInsert(Uint32 index);
+		void tableResize(size_type count);
+		void tableBuild();
+		void tableDrop();
+		
 	};
 	
 	
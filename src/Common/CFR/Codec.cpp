@@ -0,0 +1,318 @@
+#include "Codec.hpp"
+
+using CFR::size_type;
+using CFR::Uint8;
+using CFR::Uint32;
+using CFR::Exception;
+
+static const size_type groupSize = 16;   // Values per bit packed group
+static const Uint32    fifoSize  = 16;   // Edge and vertex FIFO entries
+static const Uint32    fifoEmpty = 0xFFFFFFFF;
+
+/* Bits per value of each group header code */
+static const Uint8 groupBits[4] = { 0, 2, 4, 8 };
+
+
+
+/* Vertices */
+
+inline Uint8 zigzag8(Uint8 delta) {
+	return static_cast<Uint8>((delta << 1) ^ (delta & 0x80 ? 0xFF : 0x00));
+}
+
+inline Uint8 unzigzag8(Uint8 value) {
+	return static_cast<Uint8>((value >> 1) ^ (value & 1 ? 0xFF : 0x00));
+}
+
+inline Uint8 groupCode(const Uint8 *values) {
+	Uint8 max = 0;
+	for (size_type i = 0; i < groupSize; i++) max |= values[i];
+	if (max == 0)   return 0;
+	if (max < 0x04) return 1;
+	if (max < 0x10) return 2;
+	return 3;
+}
+
+void CFR::encodeVertices(const Uint8 *vertices, size_type count, size_type stride, std::vector<Uint8> &out)
+{
+	size_type groups = (count + groupSize - 1) / groupSize;
+	std::vector<Uint8> plane(groups * groupSize, 0);
+	std::vector<Uint8> codes(groups);
+	for (size_type k = 0; k < stride; k++) {
+		
+		/* Zigzagged deltas of byte k */
+		Uint8 last = 0;
+		for (size_type i = 0; i < count; i++) {
+			Uint8 value = vertices[i * stride + k];
+			plane[i] = zigzag8(static_cast<Uint8>(value - last));
+			last = value;
+		}
+		
+		/* Group headers, four to a byte */
+		for (size_type g = 0; g < groups; g++) codes[g] = groupCode(&plane[g * groupSize]);
+		for (size_type g = 0; g < groups; g += 4) {
+			Uint8 header = 0;
+			for (size_type j = 0; j < 4 && g + j < groups; j++) header |= codes[g + j] << (j * 2);
+			out.push_back(header);
+		}
+		
+		/* Group values packed at their width */
+		for (size_type g = 0; g < groups; g++) {
+			Uint8 bits = groupBits[codes[g]];
+			if (bits == 0) continue;
+			const Uint8 *values = &plane[g * groupSize];
+			size_type perByte = 8 / bits;
+			for (size_type i = 0; i < groupSize; i += perByte) {
+				Uint8 byte = 0;
+				for (size_type j = 0; j < perByte; j++) byte |= values[i + j] << (j * bits);
+				out.push_back(byte);
+			}
+		}
+	}
+}
+
+void CFR::decodeVertices(const Uint8 *data, size_type size, size_type count, size_type stride, Uint8 *vertices)
+{
+	const Uint8 *end = data + size;
+	size_type groups = (count + groupSize - 1) / groupSize;
+	Uint8 values[groupSize];
+	for (size_type k = 0; k < stride; k++) {
+		
+		const Uint8 *headers = data;
+		if (static_cast<size_type>(end - data) < (groups + 3) / 4) {
+			throw Exception("Invalid vertex data.");
+		}
+		data += (groups + 3) / 4;
+		
+		Uint8 last = 0;
+		for (size_type g = 0; g < groups; g++) {
+			Uint8 bits = groupBits[(headers[g / 4] >> ((g % 4) * 2)) & 3];
+			size_type bytes = groupSize * bits / 8;
+			if (static_cast<size_type>(end - data) < bytes) {
+				throw Exception("Invalid vertex data.");
+			}
+			if (bits == 0) {
+				for (size_type i = 0; i < groupSize; i++) values[i] = 0;
+			} else {
+				size_type perByte = 8 / bits;
+				Uint8 mask = static_cast<Uint8>((1 << bits) - 1);
+				for (size_type i = 0; i < groupSize; i++) {
+					values[i] = (data[i / perByte] >> ((i % perByte) * bits)) & mask;
+				}
+			}
+			data += bytes;
+			
+			size_type first = g * groupSize;
+			for (size_type i = 0; i < groupSize && first + i < count; i++) {
+				last = static_cast<Uint8>(last + unzigzag8(values[i]));
+				vertices[(first + i) * stride + k] = last;
+			}
+		}
+	}
+	if (data != end) {
+		throw Exception("Invalid vertex data.");
+	}
+}
+
+
+
+/* Triangles */
+
+/* Recent edges and vertices, index 0 is the newest */
+struct TriangleFifo {
+	
+	Uint32 edges[fifoSize][2];
+	Uint32 vertices[fifoSize];
+	Uint32 edgeHead   = 0;
+	Uint32 vertexHead = 0;
+	Uint32 next = 0; // Vertex expected to be new, one past the largest seen
+	Uint32 last = 0; // Last vertex coded by value
+	
+	TriangleFifo() {
+		for (Uint32 i = 0; i < fifoSize; i++) {
+			edges[i][0] = edges[i][1] = vertices[i] = fifoEmpty;
+		}
+	}
+	
+	void pushEdge(Uint32 a, Uint32 b) {
+		edges[edgeHead][0] = a;
+		edges[edgeHead][1] = b;
+		edgeHead = (edgeHead + 1) % fifoSize;
+	}
+	
+	void pushVertex(Uint32 v) {
+		vertices[vertexHead] = v;
+		vertexHead = (vertexHead + 1) % fifoSize;
+	}
+	
+	const Uint32* getEdge(Uint32 index) const {
+		return edges[(edgeHead + fifoSize - 1 - index) % fifoSize];
+	}
+	
+	Uint32 getVertex(Uint32 index) const {
+		return vertices[(vertexHead + fifoSize - 1 - index) % fifoSize];
+	}
+	
+	int findEdge(Uint32 a, Uint32 b) const {
+		for (Uint32 i = 0; i < fifoSize; i++) {
+			const Uint32 *edge = getEdge(i);
+			if (edge[0] == a && edge[1] == b) return static_cast<int>(i);
+		}
+		return -1;
+	}
+	
+	int findVertex(Uint32 v) const {
+		for (Uint32 i = 0; i < fifoSize; i++) {
+			if (getVertex(i) == v) return static_cast<int>(i);
+		}
+		return -1;
+	}
+	
+	/* Edges of a finished triangle as a neighbour with the same winding sees them */
+	void pushTriangle(Uint32 a, Uint32 b, Uint32 c) {
+		pushEdge(b, a);
+		pushEdge(c, b);
+		pushEdge(a, c);
+	}
+	
+};
+
+/* Vertex reference kinds */
+static const Uint8 vertexNext  = 0; // The next new vertex
+static const Uint8 vertexFifo  = 1; // Index into the vertex FIFO follows
+static const Uint8 vertexValue = 2; // Zigzag varint delta from the last value follows
+
+inline void writeVarint(std::vector<Uint8> &out, Uint32 v) {
+	while (v >= 0x80) {
+		out.push_back(static_cast<Uint8>(v | 0x80));
+		v >>= 7;
+	}
+	out.push_back(static_cast<Uint8>(v));
+}
+
+inline Uint32 readVarint(const Uint8 *&data, const Uint8 *end) {
+	Uint32 v = 0;
+	for (unsigned shift = 0; shift < 35; shift += 7) {
+		if (data == end) break;
+		Uint8 byte = *data++;
+		v |= static_cast<Uint32>(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) return v;
+	}
+	throw Exception("Invalid triangle data.");
+}
+
+inline Uint8 encodeVertex(TriangleFifo &fifo, Uint32 v, std::vector<Uint8> &extra) {
+	if (v == fifo.next) {
+		fifo.next++;
+		fifo.last = v;
+		fifo.pushVertex(v);
+		return vertexNext;
+	}
+	int index = fifo.findVertex(v);
+	if (index >= 0) {
+		extra.push_back(static_cast<Uint8>(index));
+		return vertexFifo;
+	}
+	Uint32 delta = v - fifo.last;
+	writeVarint(extra, (delta << 1) ^ (delta & 0x80000000 ? 0xFFFFFFFF : 0));
+	if (v >= fifo.next) fifo.next = v + 1;
+	fifo.last = v;
+	fifo.pushVertex(v);
+	return vertexValue;
+}
+
+inline Uint32 decodeVertex(TriangleFifo &fifo, Uint8 kind, const Uint8 *&data, const Uint8 *end) {
+	if (kind == vertexNext) {
+		Uint32 v = fifo.next++;
+		fifo.last = v;
+		fifo.pushVertex(v);
+		return v;
+	} else if (kind == vertexFifo) {
+		if (data == end || *data >= fifoSize) throw Exception("Invalid triangle data.");
+		return fifo.getVertex(*data++);
+	} else if (kind == vertexValue) {
+		Uint32 zigzag = readVarint(data, end);
+		Uint32 v = fifo.last + ((zigzag >> 1) ^ (zigzag & 1 ? 0xFFFFFFFF : 0));
+		if (v >= fifo.next) fifo.next = v + 1;
+		fifo.last = v;
+		fifo.pushVertex(v);
+		return v;
+	}
+	throw Exception("Invalid triangle data.");
+}
+
+/*
+	Code byte of a triangle:
+		bits 0-1: rotation 0-2 of a triangle starting with a FIFO edge, 3 if none
+		Edge:    bits 2-5 edge FIFO index, bits 6-7 kind of the third vertex
+		No edge: bits 2-3, 4-5, 6-7 kinds of the three vertices
+	Data of the coded vertices follows in order.
+*/
+
+void CFR::encodeTriangles(const Uint32 *elements, size_type count, std::vector<Uint8> &out)
+{
+	if (count % 3 != 0) {
+		throw Exception("Element count isn't a multiple of 3.");
+	}
+	TriangleFifo fifo;
+	std::vector<Uint8> extra;
+	for (size_type i = 0; i < count; i += 3) {
+		Uint32 a = elements[i + 0];
+		Uint32 b = elements[i + 1];
+		Uint32 c = elements[i + 2];
+		Uint32 rotated[3][3] = { { a, b, c }, { b, c, a }, { c, a, b } };
+		extra.clear();
+		
+		int rotation = 0, edge = -1;
+		for (; rotation < 3 && edge < 0; rotation++) {
+			edge = fifo.findEdge(rotated[rotation][0], rotated[rotation][1]);
+		}
+		
+		if (edge >= 0) {
+			Uint8 kind = encodeVertex(fifo, rotated[rotation - 1][2], extra);
+			out.push_back(static_cast<Uint8>((rotation - 1) | (edge << 2) | (kind << 6)));
+		} else {
+			Uint8 kindA = encodeVertex(fifo, a, extra);
+			Uint8 kindB = encodeVertex(fifo, b, extra);
+			Uint8 kindC = encodeVertex(fifo, c, extra);
+			out.push_back(static_cast<Uint8>(3 | (kindA << 2) | (kindB << 4) | (kindC << 6)));
+		}
+		out.insert(out.end(), extra.begin(), extra.end());
+		fifo.pushTriangle(a, b, c);
+	}
+}
+
+void CFR::decodeTriangles(const Uint8 *data, size_type size, size_type count, Uint32 *elements)
+{
+	if (count % 3 != 0) {
+		throw Exception("Element count isn't a multiple of 3.");
+	}
+	const Uint8 *end = data + size;
+	TriangleFifo fifo;
+	for (size_type i = 0; i < count; i += 3) {
+		if (data == end) throw Exception("Invalid triangle data.");
+		Uint8 code = *data++;
+		Uint32 a, b, c;
+		if ((code & 3) != 3) {
+			const Uint32 *edge = fifo.getEdge((code >> 2) & 15);
+			Uint32 x = edge[0], y = edge[1];
+			Uint32 z = decodeVertex(fifo, code >> 6, data, end);
+			switch (code & 3) {
+			case 0:  a = x; b = y; c = z; break;
+			case 1:  a = z; b = x; c = y; break;
+			default: a = y; b = z; c = x; break;
+			}
+		} else {
+			a = decodeVertex(fifo, (code >> 2) & 3, data, end);
+			b = decodeVertex(fifo, (code >> 4) & 3, data, end);
+			c = decodeVertex(fifo, (code >> 6) & 3, data, end);
+		}
+		elements[i + 0] = a;
+		elements[i + 1] = b;
+		elements[i + 2] = c;
+		fifo.pushTriangle(a, b, c);
+	}
+	if (data != end) {
+		throw Exception("Invalid triangle data.");
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+#ifndef _CFR_CODEC_HPP_
+#define _CFR_CODEC_HPP_
+
+#include "Common.hpp"
+#include <vector>
+
+namespace CFR {
+	
+	
+	
+	/* Byte plane delta coding of count interleaved vertices of stride bytes,
+	 * appended to out. Each byte of a vertex is delta coded against the same
+	 * byte of the previous vertex, zigzagged and bit packed in groups of 16. */
+	void encodeVertices(const Uint8 *vertices, size_type count, size_type stride, std::vector<Uint8> &out);
+	
+	/* Decode count * stride bytes of vertices from size bytes of data
+	 * Throws CFR::Exception if the data is malformed */
+	void decodeVertices(const Uint8 *data, size_type size, size_type count, size_type stride, Uint8 *vertices);
+	
+	/* Edge and vertex FIFO coding of count elements, a multiple of 3, appended
+	 * to out. Triangles sharing an edge with a recent one take a byte or two.
+	 * Triangle order and rotation are kept. */
+	void encodeTriangles(const Uint32 *elements, size_type count, std::vector<Uint8> &out);
+	
+	/* Decode count elements from size bytes of data
+	 * Throws CFR::Exception if the data is malformed */
+	void decodeTriangles(const Uint8 *data, size_type size, size_type count, Uint32 *elements);
+	
+	
+	
+} // namespace CFR
+
+#endif // _CFR_CODEC_HPP_
@@ -16,6 +16,7 @@ namespace CFR {
 	typedef std::uint8_t  Uint8;
 	typedef std::uint16_t Uint16;
 	typedef std::uint32_t Uint32;
+	typedef std::uint64_t Uint64;
 	
 	struct Pixel8;
 	struct Pixel16;
@@ -25,11 +26,17 @@ namespace CFR {
 	struct Vec3;
 	struct Vec4;
 	struct Vertex;
+	struct Meshlet;
 	class  Exception;
 	class  BaseTexture;
 	class  Texture;
 	class  BaseGeometry;
 	class  Geometry;
+	class  GeometryBuilder;
+	class  GeometryView;
+	struct AttributeView;
+	struct ElementView;
+	struct ModelLod;
 	class  ModelObject;
 	class  Model;
 	
@@ -1,5 +1,14 @@
 #include "Geometry.hpp"
+#include "Codec.hpp"
 #include <fstream>
+#include <vector>
+#include <iterator>  // std::istreambuf_iterator
+#include <thread>
+#include <atomic>
+#include <exception> // std::exception_ptr
+#include <system_error> // std::system_error
+#include <algorithm> // std::min, std::max
+#include <cmath>     // std::abs, std::sqrt
 #include <glm/gtc/packing.hpp>
 
 using CFR::BaseGeometry;
@@ -8,8 +17,20 @@ using CFR::size_type;
 using CFR::Uint8;
 using CFR::Uint16;
 using CFR::Uint32;
+using CFR::Uint64;
 using CFR::Vertex;
+using CFR::Meshlet;
+using CFR::Vec3;
+using CFR::GeometryView;
+using CFR::AttributeView;
+using CFR::ElementView;
 using CFR::Exception;
+using CFR::encodeVertices;
+using CFR::decodeVertices;
+using CFR::encodeTriangles;
+using CFR::decodeTriangles;
+using CFR::VertexStorage;
+using CFR::STORAGE_FULL;
 using CFR::TYPE_DISABLE;
 using CFR::TYPE_FLOAT;
 using CFR::TYPE_HALF_FLOAT;
@@ -21,6 +42,12 @@ using CFR::TYPE_NORM_SHORT;
 using CFR::TYPE_NORM_UNSIGNED_SHORT;
 using CFR::TYPE_NORM_BYTE;
 using CFR::TYPE_NORM_UNSIGNED_BYTE;
+using CFR::TYPE_OCT_NORM_BYTE;
+using CFR::TYPE_OCT_NORM_SHORT;
+using CFR::TYPE_QTANGENT_NORM_BYTE;
+using CFR::TYPE_QTANGENT_NORM_SHORT;
+using CFR::TYPE_BOUNDS_NORM_UNSIGNED_BYTE;
+using CFR::TYPE_BOUNDS_NORM_UNSIGNED_SHORT;
 typedef std::int8_t  Sint8;
 typedef std::int16_t Sint16;
 typedef std::int32_t Sint32;
@@ -31,7 +58,22 @@ using glm::clamp;
 
 /* Float packing */
 
-inline bool typeIsValid(Uint8 type) {
+static const Uint8 encodingNone       = 0b00000000;
+static const Uint8 encodingOctahedral = 0b01000000;
+static const Uint8 encodingQTangent   = 0b00100000;
+static const Uint8 encodingBounds     = 0b01100000;
+
+inline Uint8 typeGetEncoding(Uint8 type) {
+	return type == TYPE_DISABLE ? encodingNone : type & 0b01100000;
+}
+
+/* Type of each stored component */
+inline Uint8 typeGetComponent(Uint8 type) {
+	return type == TYPE_DISABLE ? type : type & 0b10011111;
+}
+
+/* Valid with no encoding or the given one */
+inline bool typeIsValid(Uint8 type, Uint8 encoding) {
 	switch (type) {
 	case TYPE_DISABLE:
 	case TYPE_FLOAT:
@@ -40,29 +82,61 @@ inline bool typeIsValid(Uint8 type) {
 	case TYPE_UNSIGNED_SHORT:
 	case TYPE_BYTE:
 	case TYPE_UNSIGNED_BYTE:
+	case TYPE_NORM_SHORT:
+	case TYPE_NORM_UNSIGNED_SHORT:
+	case TYPE_NORM_BYTE:
+	case TYPE_NORM_UNSIGNED_BYTE:
 		return true;
+	case TYPE_OCT_NORM_BYTE:
+	case TYPE_OCT_NORM_SHORT:
+		return encoding == encodingOctahedral;
+	case TYPE_QTANGENT_NORM_BYTE:
+	case TYPE_QTANGENT_NORM_SHORT:
+		return encoding == encodingQTangent;
+	case TYPE_BOUNDS_NORM_UNSIGNED_BYTE:
+	case TYPE_BOUNDS_NORM_UNSIGNED_SHORT:
+		return encoding == encodingBounds;
 	default:
 		return false;
 	}
 }
 
+/* Bytes per component */
 inline Uint32 typeGetSize(Uint8 type) {
-	switch (type) {
+	switch (typeGetComponent(type)) {
 	default:
 	case TYPE_DISABLE:
 		return 0;
 	case TYPE_BYTE:
 	case TYPE_UNSIGNED_BYTE:
+	case TYPE_NORM_BYTE:
+	case TYPE_NORM_UNSIGNED_BYTE:
 		return 1;
 	case TYPE_HALF_FLOAT:
 	case TYPE_SHORT:
 	case TYPE_UNSIGNED_SHORT:
+	case TYPE_NORM_SHORT:
+	case TYPE_NORM_UNSIGNED_SHORT:
 		return 2;
 	case TYPE_FLOAT:
 		return 4;
 	}
 }
 
+/* Stored components of an attribute with the given dimensions */
+inline Uint32 typeGetCount(Uint8 type, Uint32 components) {
+	switch (typeGetEncoding(type)) {
+	case encodingOctahedral: return 2;
+	case encodingQTangent:   return 4;
+	default:                 return components;
+	}
+}
+
+/* Bytes per vertex of an attribute */
+inline Uint32 typeGetBytes(Uint8 type, Uint32 components) {
+	return typeGetCount(type, components) * typeGetSize(type);
+}
+
 inline Uint32 packFull(float v) { return *reinterpret_cast<Uint32*>(&v); }
 inline Uint16 packHalf(float v) { return glm::packHalf1x16 (v); }
 
@@ -90,7 +164,7 @@ inline float unpackSByte (Sint8  v) { return clamp(static_cast<float>(v), -127.f
 inline float unpackUByte (Uint8  v) { return clamp(static_cast<float>(v), +0.f,     255.f  ); }
 
 inline Uint32 packFloat(float v, Uint8 type) {
-	switch (type) {
+	switch (typeGetComponent(type)) {
 	case TYPE_DISABLE: default:    return 0;
 	case TYPE_FLOAT:               return packFull  (v);
 	case TYPE_HALF_FLOAT:          return packHalf  (v);
@@ -105,6 +179,228 @@ inline Uint32 packFloat(float v, Uint8 type) {
 	}
 }
 
+inline float unpackFloat(Uint32 v, Uint8 type) {
+	switch (typeGetComponent(type)) {
+	case TYPE_DISABLE: default:    return 0.f;
+	case TYPE_FLOAT:               return unpackFull  (v);
+	case TYPE_HALF_FLOAT:          return unpackHalf  (static_cast<Uint16>(v));
+	case TYPE_SHORT:               return unpackSShort(static_cast<Sint16>(v));
+	case TYPE_UNSIGNED_SHORT:      return unpackUShort(static_cast<Uint16>(v));
+	case TYPE_BYTE:                return unpackSByte (static_cast<Sint8 >(v));
+	case TYPE_UNSIGNED_BYTE:       return unpackUByte (static_cast<Uint8 >(v));
+	case TYPE_NORM_SHORT:          return unpackNormSShort(static_cast<Uint16>(v));
+	case TYPE_NORM_UNSIGNED_SHORT: return unpackNormUShort(static_cast<Uint16>(v));
+	case TYPE_NORM_BYTE:           return unpackNormSByte (static_cast<Uint8 >(v));
+	case TYPE_NORM_UNSIGNED_BYTE:  return unpackNormUByte (static_cast<Uint8 >(v));
+	}
+}
+
+/* Packed values in memory, little endian at the file size */
+
+inline void storePacked(Uint8 *&out, Uint32 v, Uint8 type) {
+	Uint32 size = typeGetSize(type);
+	for (Uint32 i = 0; i < size; i++) *out++ = static_cast<Uint8>(v >> (i * 8));
+}
+
+inline Uint32 loadPacked(const Uint8 *&in, Uint8 type) {
+	Uint32 size = typeGetSize(type), v = 0;
+	for (Uint32 i = 0; i < size; i++) v |= static_cast<Uint32>(*in++) << (i * 8);
+	return v;
+}
+
+inline void loadAttribute(const Uint8 *&in, float &value, Uint32 &pack, Uint8 type) {
+	if (type == TYPE_DISABLE) return;
+	pack  = loadPacked(in, type);
+	value = unpackFloat(pack, type);
+}
+
+
+
+/* Normal and tangent encodings */
+
+inline float signNotZero(float v) {
+	return v < 0.f ? -1.f : 1.f;
+}
+
+inline void octahedralDecode(const float *in, float *n) {
+	float x = in[0], y = in[1];
+	float z = 1.f - std::abs(x) - std::abs(y);
+	if (z < 0.f) {
+		float fold = (1.f - std::abs(y)) * signNotZero(x);
+		y = (1.f - std::abs(x)) * signNotZero(y);
+		x = fold;
+	}
+	glm::vec3 v = glm::normalize(glm::vec3(x, y, z));
+	n[0] = v.x;
+	n[1] = v.y;
+	n[2] = v.z;
+}
+
+/* Unit vector to [-1, 1]^2 on a grid of steps per unit, the lower half
+ * folded over the diagonals. The closest of the 4 grid points around the
+ * exact mapping is taken, on the folded edges where two points decode to
+ * the same normal the positive one is, so decoding and encoding again
+ * gives the same point. */
+inline void octahedralEncode(const float *n, float steps, float *out) {
+	float sum = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+	if (sum == 0.f) {
+		out[0] = out[1] = 0.f;
+		return;
+	}
+	float x = n[0] / sum;
+	float y = n[1] / sum;
+	if (n[2] < 0.f) {
+		float fold = (1.f - std::abs(y)) * signNotZero(x);
+		y = (1.f - std::abs(x)) * signNotZero(y);
+		x = fold;
+	}
+	glm::vec3 unit = glm::normalize(glm::vec3(n[0], n[1], n[2]));
+	float best = 5.f;
+	for (int i = 0; i < 4; i++) {
+		float grid[2] = {
+			clamp((i & 1 ? std::ceil(x * steps) : std::floor(x * steps)) / steps, -1.f, 1.f),
+			clamp((i & 2 ? std::ceil(y * steps) : std::floor(y * steps)) / steps, -1.f, 1.f)
+		};
+		float decoded[3];
+		octahedralDecode(grid, decoded);
+		glm::vec3 error = glm::vec3(decoded[0], decoded[1], decoded[2]) - unit;
+		float distance = glm::dot(error, error);
+		if (distance < best) {
+			best = distance;
+			out[0] = grid[0];
+			out[1] = grid[1];
+		}
+	}
+	if (std::abs(out[0]) + std::abs(out[1]) > 1.f) {
+		if (std::abs(out[1]) == 1.f) out[0] = std::abs(out[0]);
+		if (std::abs(out[0]) == 1.f) out[1] = std::abs(out[1]);
+	}
+}
+
+/* Rotation of the frame with columns tangent, cross(normal, tangent) and
+ * normal on a grid of steps per unit. The tangent is orthogonalized first,
+ * w is the handedness and at least one step away from 0 so its sign
+ * survives. Decoding normalizes, so the grid point is taken where rounding
+ * its own normalized direction gives it back. */
+inline void qtangentEncode(const float *normal, const float *tangent, float steps, float *q) {
+	glm::vec3 n(normal[0], normal[1], normal[2]);
+	n = glm::length(n) > 0.f ? glm::normalize(n) : glm::vec3(0.f, 0.f, 1.f);
+	glm::vec3 t(tangent[0], tangent[1], tangent[2]);
+	t = t - n * glm::dot(n, t);
+	if (glm::length(t) < 1e-6f) {
+		t = glm::cross(n, std::abs(n.x) < 0.9f ? glm::vec3(1.f, 0.f, 0.f) : glm::vec3(0.f, 1.f, 0.f));
+	}
+	t = glm::normalize(t);
+	glm::vec3 b = glm::cross(n, t);
+	
+	float r[4], trace = t.x + b.y + n.z;
+	if (trace > 0.f) {
+		float s = std::sqrt(trace + 1.f) * 2.f;
+		r[0] = (b.z - n.y) / s; r[1] = (n.x - t.z) / s; r[2] = (t.y - b.x) / s; r[3] = 0.25f * s;
+	} else if (t.x > b.y && t.x > n.z) {
+		float s = std::sqrt(1.f + t.x - b.y - n.z) * 2.f;
+		r[0] = 0.25f * s; r[1] = (b.x + t.y) / s; r[2] = (n.x + t.z) / s; r[3] = (b.z - n.y) / s;
+	} else if (b.y > n.z) {
+		float s = std::sqrt(1.f + b.y - t.x - n.z) * 2.f;
+		r[0] = (b.x + t.y) / s; r[1] = 0.25f * s; r[2] = (n.y + b.z) / s; r[3] = (n.x - t.z) / s;
+	} else {
+		float s = std::sqrt(1.f + n.z - t.x - b.y) * 2.f;
+		r[0] = (n.x + t.z) / s; r[1] = (n.y + b.z) / s; r[2] = 0.25f * s; r[3] = (t.y - b.x) / s;
+	}
+	
+	float scale = (r[3] < 0.f ? -steps : steps) / std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+	for (int i = 0; i < 4; i++) r[i] = round(r[i] * scale);
+	r[3] = std::max(r[3], 1.f);
+	for (int pass = 0; pass < 4; pass++) {
+		float next[4];
+		scale = steps / std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+		for (int i = 0; i < 4; i++) next[i] = round(r[i] * scale);
+		next[3] = std::max(next[3], 1.f);
+		if (std::equal(next, next + 4, r)) break;
+		std::copy(next, next + 4, r);
+	}
+	
+	float sign = signNotZero(tangent[3]);
+	for (int i = 0; i < 4; i++) q[i] = r[i] / steps * sign;
+}
+
+inline void qtangentDecode(const float *q, float *normal, float *tangent) {
+	float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	if (length == 0.f) length = 1.f;
+	float x = q[0] / length, y = q[1] / length, z = q[2] / length, w = q[3] / length;
+	tangent[0] = 1.f - 2.f * (y * y + z * z);
+	tangent[1] = 2.f * (x * y + w * z);
+	tangent[2] = 2.f * (x * z - w * y);
+	tangent[3] = signNotZero(q[3]);
+	if (normal) {
+		normal[0] = 2.f * (x * z + w * y);
+		normal[1] = 2.f * (y * z - w * x);
+		normal[2] = 1.f - 2.f * (x * x + y * y);
+	}
+}
+
+/* Snorm steps per unit of an encoded type */
+inline float typeGetSteps(Uint8 type) {
+	return typeGetSize(type) == 1 ? 127.f : 32767.f;
+}
+
+/* Position within the bounds to [0, 1]^3, an empty axis is 0 */
+inline void encodePosition(const Vertex &v, Uint8 type, const Vec3 &low, const Vec3 &high, float *out) {
+	float p[3] = { v.position.x, v.position.y, v.position.z };
+	float l[3] = { low.x,  low.y,  low.z  };
+	float h[3] = { high.x, high.y, high.z };
+	for (int i = 0; i < 3; i++) {
+		if (typeGetEncoding(type) != encodingBounds) {
+			out[i] = p[i];
+		} else {
+			out[i] = h[i] > l[i] ? (p[i] - l[i]) / (h[i] - l[i]) : 0.f;
+		}
+	}
+}
+
+/* Components to store, as floats for the component type */
+inline void encodeNormal(const Vertex &v, Uint8 type, float *out) {
+	float n[3] = { v.normal.x, v.normal.y, v.normal.z };
+	if (typeGetEncoding(type) == encodingOctahedral) {
+		octahedralEncode(n, typeGetSteps(type), out);
+		out[2] = 0.f;
+	} else {
+		out[0] = n[0]; out[1] = n[1]; out[2] = n[2];
+	}
+}
+
+inline void encodeTangent(const Vertex &v, Uint8 type, float *out) {
+	float n[3] = { v.normal.x,  v.normal.y,  v.normal.z };
+	float t[4] = { v.tangent.x, v.tangent.y, v.tangent.z, v.tangent.w };
+	if (typeGetEncoding(type) == encodingQTangent) {
+		qtangentEncode(n, t, typeGetSteps(type), out);
+	} else {
+		out[0] = t[0]; out[1] = t[1]; out[2] = t[2]; out[3] = t[3];
+	}
+}
+
+/* Loaded components to the attributes they encode */
+inline void decodeVertex(Vertex &v, Uint8 typePosition, Uint8 typeNormal, Uint8 typeTangent, const Vec3 &low, const Vec3 &high) {
+	if (typeGetEncoding(typePosition) == encodingBounds) {
+		v.position.x = low.x + v.position.x * (high.x - low.x);
+		v.position.y = low.y + v.position.y * (high.y - low.y);
+		v.position.z = low.z + v.position.z * (high.z - low.z);
+	}
+	if (typeGetEncoding(typeNormal) == encodingOctahedral) {
+		float in[2] = { v.normal.x, v.normal.y }, n[3];
+		octahedralDecode(in, n);
+		v.normal.x = n[0]; v.normal.y = n[1]; v.normal.z = n[2];
+	}
+	if (typeGetEncoding(typeTangent) == encodingQTangent) {
+		float q[4] = { v.tangent.x, v.tangent.y, v.tangent.z, v.tangent.w }, n[3], t[4];
+		qtangentDecode(q, typeNormal == TYPE_DISABLE ? n : nullptr, t);
+		v.tangent.x = t[0]; v.tangent.y = t[1]; v.tangent.z = t[2]; v.tangent.w = t[3];
+		if (typeNormal == TYPE_DISABLE) {
+			v.normal.x = n[0]; v.normal.y = n[1]; v.normal.z = n[2];
+		}
+	}
+}
+
 
 
 /* Geometry */
@@ -117,17 +413,11 @@ Geometry::Geometry(const BaseGeometry &copy)
 : BaseGeometry(copy)
 {}
 
-void Geometry::loadFromFile(const std::string &file)
+void Geometry::loadFromFile(const std::string &file, unsigned threads)
 {
-	try {
-		std::ifstream stream;
-		stream.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		stream.open(file, std::ios::binary);
-		stream >> *this;
-		stream.close();
-	} catch (std::ios::failure &fail) {
-		throw Exception("IO error: " + std::string(fail.what()));
-	}
+	GeometryView view;
+	view.open(file, threads);
+	view.materialize(*this);
 }
 
 void Geometry::saveToFile(const std::string &file) const
@@ -143,20 +433,81 @@ void Geometry::saveToFile(const std::string &file) const
 	}
 }
 
-Vertex Geometry::compressVertex(Vertex v)
+void Geometry::setFileVersion(Uint32 version)
 {
-	v.position.packX = packFloat(v.position.x, typePosition);
-	v.position.packY = packFloat(v.position.y, typePosition);
-	v.position.packZ = packFloat(v.position.z, typePosition);
+	if (version != 1 && version != 2) {
+		throw Exception("Invalid version.");
+	}
+	fileVersion = version;
+}
+
+Uint32 Geometry::getFileVersion() const
+{
+	return fileVersion;
+}
+
+Vertex Geometry::compressVertex(Vertex v) const
+{
+	float p[3], n[3], t[4];
+	encodePosition(v, typePosition, boundsLow, boundsHigh, p);
+	encodeNormal  (v, typeNormal,  n);
+	encodeTangent (v, typeTangent, t);
+	v.position.packX = packFloat(p[0], typePosition);
+	v.position.packY = packFloat(p[1], typePosition);
+	v.position.packZ = packFloat(p[2], typePosition);
 	v.texcoord.packX = packFloat(v.texcoord.x, typeTexcoord);
 	v.texcoord.packY = packFloat(v.texcoord.y, typeTexcoord);
-	v.normal.packX   = packFloat(v.normal.x,   typeNormal);
-	v.normal.packY   = packFloat(v.normal.y,   typeNormal);
-	v.normal.packZ   = packFloat(v.normal.z,   typeNormal);
-	v.tangent.packX  = packFloat(v.tangent.x,  typeTangent);
-	v.tangent.packY  = packFloat(v.tangent.y,  typeTangent);
-	v.tangent.packZ  = packFloat(v.tangent.z,  typeTangent);
-	v.tangent.packW  = packFloat(v.tangent.w,  typeTangent);
+	v.normal.packX   = packFloat(n[0], typeNormal);
+	v.normal.packY   = packFloat(n[1], typeNormal);
+	v.normal.packZ   = packFloat(n[2], typeNormal);
+	v.tangent.packX  = packFloat(t[0], typeTangent);
+	v.tangent.packY  = packFloat(t[1], typeTangent);
+	v.tangent.packZ  = packFloat(t[2], typeTangent);
+	v.tangent.packW  = packFloat(t[3], typeTangent);
+	return v;
+}
+
+size_type Geometry::packedSize() const
+{
+	return getVertexSize();
+}
+
+void Geometry::packVertex(const Vertex &v, Uint8 *out) const
+{
+	storePacked(out, v.position.packX, typePosition);
+	storePacked(out, v.position.packY, typePosition);
+	storePacked(out, v.position.packZ, typePosition);
+	storePacked(out, v.texcoord.packX, typeTexcoord);
+	storePacked(out, v.texcoord.packY, typeTexcoord);
+	storePacked(out, v.normal.packX,   typeNormal);
+	storePacked(out, v.normal.packY,   typeNormal);
+	if (typeGetCount(typeNormal, 3) == 3) {
+		storePacked(out, v.normal.packZ, typeNormal);
+	}
+	storePacked(out, v.tangent.packX,  typeTangent);
+	storePacked(out, v.tangent.packY,  typeTangent);
+	storePacked(out, v.tangent.packZ,  typeTangent);
+	storePacked(out, v.tangent.packW,  typeTangent);
+}
+
+Vertex Geometry::unpackVertex(const Uint8 *in) const
+{
+	Vertex v;
+	loadAttribute(in, v.position.x, v.position.packX, typePosition);
+	loadAttribute(in, v.position.y, v.position.packY, typePosition);
+	loadAttribute(in, v.position.z, v.position.packZ, typePosition);
+	loadAttribute(in, v.texcoord.x, v.texcoord.packX, typeTexcoord);
+	loadAttribute(in, v.texcoord.y, v.texcoord.packY, typeTexcoord);
+	loadAttribute(in, v.normal.x,   v.normal.packX,   typeNormal);
+	loadAttribute(in, v.normal.y,   v.normal.packY,   typeNormal);
+	if (typeGetCount(typeNormal, 3) == 3) {
+		loadAttribute(in, v.normal.z, v.normal.packZ, typeNormal);
+	}
+	loadAttribute(in, v.tangent.x,  v.tangent.packX,  typeTangent);
+	loadAttribute(in, v.tangent.y,  v.tangent.packY,  typeTangent);
+	loadAttribute(in, v.tangent.z,  v.tangent.packZ,  typeTangent);
+	loadAttribute(in, v.tangent.w,  v.tangent.packW,  typeTangent);
+	decodeVertex(v, typePosition, typeNormal, typeTangent, boundsLow, boundsHigh);
 	return v;
 }
 
@@ -172,34 +523,46 @@ Uint32 Geometry::addVertex(const Vertex &v)
 
 void Geometry::setTypePosition(Uint8 type)
 {
-	if (!typeIsValid(type)) {
+	if (!typeIsValid(type, encodingBounds)) {
 		throw Exception("Invalid position type.");
 	}
+	VertexStorage storage = getVertexStorage();
+	setVertexStorage(STORAGE_FULL);
 	typePosition = type;
+	setVertexStorage(storage);
 }
 
 void Geometry::setTypeTexcoord(Uint8 type)
 {
-	if (!typeIsValid(type)) {
+	if (!typeIsValid(type, encodingNone)) {
 		throw Exception("Invalid texcoord type.");
 	}
+	VertexStorage storage = getVertexStorage();
+	setVertexStorage(STORAGE_FULL);
 	typeTexcoord = type;
+	setVertexStorage(storage);
 }
 
 void Geometry::setTypeNormal(Uint8 type)
 {
-	if (!typeIsValid(type)) {
+	if (!typeIsValid(type, encodingOctahedral)) {
 		throw Exception("Invalid normal type.");
 	}
+	VertexStorage storage = getVertexStorage();
+	setVertexStorage(STORAGE_FULL);
 	typeNormal = type;
+	setVertexStorage(storage);
 }
 
 void Geometry::setTypeTangent(Uint8 type)
 {
-	if (!typeIsValid(type)) {
+	if (!typeIsValid(type, encodingQTangent)) {
 		throw Exception("Invalid tangent type.");
 	}
+	VertexStorage storage = getVertexStorage();
+	setVertexStorage(STORAGE_FULL);
 	typeTangent = type;
+	setVertexStorage(storage);
 }
 
 Uint8 Geometry::getTypePosition() const
@@ -222,6 +585,51 @@ Uint8 Geometry::getTypeTangent() const
 	return typeTangent;
 }
 
+size_type Geometry::getVertexSize() const
+{
+	return typeGetBytes(typePosition, 3) + typeGetBytes(typeTexcoord, 2)
+	     + typeGetBytes(typeNormal,   3) + typeGetBytes(typeTangent,  4);
+}
+
+void Geometry::setBounds(const Vec3 &low, const Vec3 &high)
+{
+	VertexStorage storage = getVertexStorage();
+	setVertexStorage(STORAGE_FULL);
+	boundsLow.x  = low.x;  boundsLow.y  = low.y;  boundsLow.z  = low.z;
+	boundsHigh.x = high.x; boundsHigh.y = high.y; boundsHigh.z = high.z;
+	setVertexStorage(storage);
+}
+
+void Geometry::fitBounds()
+{
+	Vec3 low, high;
+	for (size_type i = 0; i < getVertexCount(); i++) {
+		Vec3 p = getVertex(i).position;
+		if (i == 0) low = high = p;
+		low.x  = std::min(low.x,  p.x); low.y  = std::min(low.y,  p.y); low.z  = std::min(low.z,  p.z);
+		high.x = std::max(high.x, p.x); high.y = std::max(high.y, p.y); high.z = std::max(high.z, p.z);
+	}
+	setBounds(low, high);
+}
+
+Vec3 Geometry::getBoundsLow() const
+{
+	return boundsLow;
+}
+
+Vec3 Geometry::getBoundsHigh() const
+{
+	return boundsHigh;
+}
+
+float Geometry::getPositionError() const
+{
+	if (typeGetEncoding(typePosition) != encodingBounds) return 0.f;
+	float steps = typeGetSize(typePosition) == 1 ? 255.f : 65535.f;
+	glm::vec3 step = glm::vec3(boundsHigh.x - boundsLow.x, boundsHigh.y - boundsLow.y, boundsHigh.z - boundsLow.z) / steps;
+	return 0.5f * glm::length(step);
+}
+
 
 
 /* Stream insertion/extraction */
@@ -246,8 +654,36 @@ inline uint32_t read32(std::istream &in) {
 	return t;
 }
 
-inline float readFloat(std::istream &in, Uint8 type) {
-	switch (type) {
+/* Bounds checked reads of a mapped file */
+struct MemoryReader {
+	const Uint8 *pos;
+	const Uint8 *end;
+};
+
+inline uint8_t read8(MemoryReader &in) {
+	if (in.pos == in.end) throw Exception("Unexpected end of file.");
+	return *in.pos++;
+}
+
+inline uint16_t read16(MemoryReader &in) {
+	uint16_t t = 0;
+	t |= static_cast<uint16_t>(read8(in)) << 0;
+	t |= static_cast<uint16_t>(read8(in)) << 8;
+	return t;
+}
+
+inline uint32_t read32(MemoryReader &in) {
+	uint32_t t = 0;
+	t |= static_cast<uint32_t>(read8(in)) << 0;
+	t |= static_cast<uint32_t>(read8(in)) << 8;
+	t |= static_cast<uint32_t>(read8(in)) << 16;
+	t |= static_cast<uint32_t>(read8(in)) << 24;
+	return t;
+}
+
+template<typename In>
+inline float readFloat(In &in, Uint8 type) {
+	switch (typeGetComponent(type)) {
 	case TYPE_FLOAT:               return unpackFull      (read32(in));
 	case TYPE_HALF_FLOAT:          return unpackHalf      (read16(in));
 	case TYPE_SHORT:               return unpackSShort    (read16(in));
@@ -279,7 +715,7 @@ inline void write32(std::ostream &out, uint32_t v) {
 }
 
 inline void writeFloat(std::ostream &out, float v, Uint8 type) {
-	switch (type) {
+	switch (typeGetComponent(type)) {
 	case TYPE_FLOAT:               write32(out, packFull      (v)); break;
 	case TYPE_HALF_FLOAT:          write16(out, packHalf      (v)); break;
 	case TYPE_SHORT:               write16(out, packSShort    (v)); break;
@@ -293,11 +729,336 @@ inline void writeFloat(std::ostream &out, float v, Uint8 type) {
 	}
 }
 
+/* Bulk writes, the packing switch is resolved once per attribute */
+
+static const size_type writeBlock = 1 << 20; // Bytes per write
+
+template<Uint8 type>
+inline Uint32 packType(float v) {
+	return packFloat(v, type);
+}
+
+struct AttributeWriter {
+	Uint32 (*pack)(float);
+	Uint32 size;
+};
+
+inline AttributeWriter attributeWriter(Uint8 type) {
+	switch (typeGetComponent(type)) {
+	case TYPE_DISABLE: default:    return { nullptr, 0 };
+	case TYPE_FLOAT:               return { packType<TYPE_FLOAT>,               4 };
+	case TYPE_HALF_FLOAT:          return { packType<TYPE_HALF_FLOAT>,          2 };
+	case TYPE_SHORT:               return { packType<TYPE_SHORT>,               2 };
+	case TYPE_UNSIGNED_SHORT:      return { packType<TYPE_UNSIGNED_SHORT>,      2 };
+	case TYPE_BYTE:                return { packType<TYPE_BYTE>,                1 };
+	case TYPE_UNSIGNED_BYTE:       return { packType<TYPE_UNSIGNED_BYTE>,       1 };
+	case TYPE_NORM_SHORT:          return { packType<TYPE_NORM_SHORT>,          2 };
+	case TYPE_NORM_UNSIGNED_SHORT: return { packType<TYPE_NORM_UNSIGNED_SHORT>, 2 };
+	case TYPE_NORM_BYTE:           return { packType<TYPE_NORM_BYTE>,           1 };
+	case TYPE_NORM_UNSIGNED_BYTE:  return { packType<TYPE_NORM_UNSIGNED_BYTE>,  1 };
+	}
+}
+
+inline void storeLittle(Uint8 *&out, Uint32 v, Uint32 size) {
+	for (Uint32 i = 0; i < size; i++) *out++ = static_cast<Uint8>(v >> (i * 8));
+}
+
+inline void writeAttribute(Uint8 *&out, const AttributeWriter &writer, const float *v, Uint32 count) {
+	if (writer.size == 0) return;
+	for (Uint32 i = 0; i < count; i++) storeLittle(out, writer.pack(v[i]), writer.size);
+}
+
+/* Vertices [start, end) in the file layout, returns the end of the output */
+inline Uint8* packVertices(const Geometry &obj, size_type start, size_type end, Uint8 *pos) {
+	AttributeWriter position = attributeWriter(obj.getTypePosition());
+	AttributeWriter texcoord = attributeWriter(obj.getTypeTexcoord());
+	AttributeWriter normal   = attributeWriter(obj.getTypeNormal());
+	AttributeWriter tangent  = attributeWriter(obj.getTypeTangent());
+	for (size_type i = start; i < end; i++) {
+		Vertex vertex = obj.getVertex(i);
+		float u[2] = { vertex.texcoord.x, vertex.texcoord.y };
+		float p[3], n[3], t[4];
+		encodePosition(vertex, obj.getTypePosition(), obj.getBoundsLow(), obj.getBoundsHigh(), p);
+		encodeNormal  (vertex, obj.getTypeNormal(),  n);
+		encodeTangent (vertex, obj.getTypeTangent(), t);
+		writeAttribute(pos, position, p, 3);
+		writeAttribute(pos, texcoord, u, 2);
+		writeAttribute(pos, normal,   n, typeGetCount(obj.getTypeNormal(), 3));
+		writeAttribute(pos, tangent,  t, 4);
+	}
+	return pos;
+}
+
+inline void writeVertices(std::ostream &out, const Geometry &obj) {
+	size_type stride = obj.getVertexSize();
+	size_type count  = obj.getVertexCount();
+	if (stride == 0) return;
+	size_type blockVertices = std::max<size_type>(1, writeBlock / stride);
+	std::vector<Uint8> block(std::min(count, blockVertices) * stride);
+	for (size_type start = 0; start < count; start += blockVertices) {
+		size_type end = std::min(count, start + blockVertices);
+		Uint8 *pos = packVertices(obj, start, end, block.data());
+		out.write(reinterpret_cast<const char*>(block.data()), pos - block.data());
+	}
+}
+
+template<Uint32 size>
+inline void writeElements(std::ostream &out, const Geometry &obj) {
+	size_type count = obj.getElementCount();
+	size_type blockElements = writeBlock / size;
+	std::vector<Uint8> block(std::min(count, blockElements) * size);
+	for (size_type start = 0; start < count; start += blockElements) {
+		size_type end = std::min(count, start + blockElements);
+		Uint8 *pos = block.data();
+		for (size_type i = start; i < end; i++) storeLittle(pos, obj.getElement(i), size);
+		out.write(reinterpret_cast<const char*>(block.data()), pos - block.data());
+	}
+}
+
+/* Version 2 chunks, each one is coded on its own */
+
+static const size_type chunkVertices = 1 << 16;
+static const size_type chunkElements = 3 << 16; // Whole triangles
+static const size_type chunkEntry    = 24;      // Bytes per chunk table entry
+static const size_type headerSize    = 32;
+static const size_type boundsSize    = 24;
+
+static const Uint8 blockVertices  = 0;
+static const Uint8 blockElements  = 1;
+static const Uint8 codecRaw       = 0;
+static const Uint8 codecVertices  = 1; // CFR::encodeVertices
+static const Uint8 codecTriangles = 2; // CFR::encodeTriangles
+
+struct Chunk {
+	Uint8  block;
+	Uint8  codec;
+	Uint32 first;
+	Uint32 count;
+	Uint32 size;
+	Uint64 offset;
+};
+
+/* Chunks fall back to raw when coding doesn't make them smaller,
+ * the chunk table follows a header of headerBytes */
+inline void writeChunks(std::ostream &out, const Geometry &obj, Uint8 bytesPerElement, Uint32 headerBytes) {
+	size_type stride = obj.getVertexSize();
+	std::vector<Chunk> chunks;
+	for (size_type first = 0; first < obj.getVertexCount(); first += chunkVertices) {
+		Uint32 count = std::min(chunkVertices, obj.getVertexCount() - first);
+		chunks.push_back({ blockVertices, codecVertices, static_cast<Uint32>(first), count, 0, 0 });
+	}
+	Uint8 codecElements = obj.getElementCount() % 3 == 0 ? codecTriangles : codecRaw;
+	for (size_type first = 0; first < obj.getElementCount(); first += chunkElements) {
+		Uint32 count = std::min(chunkElements, obj.getElementCount() - first);
+		chunks.push_back({ blockElements, codecElements, static_cast<Uint32>(first), count, 0, 0 });
+	}
+	
+	std::vector<std::vector<Uint8>> data(chunks.size());
+	std::vector<Uint8>  raw;
+	std::vector<Uint32> triangles;
+	for (size_type i = 0; i < chunks.size(); i++) {
+		Chunk &chunk = chunks[i];
+		if (chunk.block == blockVertices) {
+			raw.resize(chunk.count * stride);
+			packVertices(obj, chunk.first, chunk.first + chunk.count, raw.data());
+			encodeVertices(raw.data(), chunk.count, stride, data[i]);
+		} else {
+			raw.resize(chunk.count * bytesPerElement);
+			Uint8 *pos = raw.data();
+			for (Uint32 j = 0; j < chunk.count; j++) storeLittle(pos, obj.getElement(chunk.first + j), bytesPerElement);
+			if (chunk.codec == codecTriangles) {
+				triangles.resize(chunk.count);
+				for (Uint32 j = 0; j < chunk.count; j++) triangles[j] = obj.getElement(chunk.first + j);
+				encodeTriangles(triangles.data(), chunk.count, data[i]);
+			}
+		}
+		if (chunk.codec == codecRaw || data[i].size() >= raw.size()) {
+			chunk.codec = codecRaw;
+			data[i] = raw;
+		}
+		chunk.size = static_cast<Uint32>(data[i].size());
+	}
+	
+	Uint64 offset = headerBytes + 4 + chunks.size() * chunkEntry;
+	write32(out, static_cast<Uint32>(chunks.size()));
+	for (Chunk &chunk : chunks) {
+		chunk.offset = offset;
+		offset += chunk.size;
+		write8 (out, chunk.block);
+		write8 (out, chunk.codec);
+		write16(out, 0);
+		write32(out, chunk.first);
+		write32(out, chunk.count);
+		write32(out, chunk.size);
+		write32(out, static_cast<Uint32>(chunk.offset));
+		write32(out, static_cast<Uint32>(chunk.offset >> 32));
+	}
+	for (const std::vector<Uint8> &bytes : data) {
+		out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+	}
+}
+
+/* Optional sections after the elements */
+
+static const Uint32 sectionMeshlets = 0x4C48534D; // MSHL
+
+template<typename In>
+inline Vec3 readVec3(In &in) {
+	Vec3 v;
+	v.x = readFloat(in, TYPE_FLOAT);
+	v.y = readFloat(in, TYPE_FLOAT);
+	v.z = readFloat(in, TYPE_FLOAT);
+	return v;
+}
+
+inline void writeVec3(std::ostream &out, const Vec3 &v) {
+	writeFloat(out, v.x, TYPE_FLOAT);
+	writeFloat(out, v.y, TYPE_FLOAT);
+	writeFloat(out, v.z, TYPE_FLOAT);
+}
+
+template<typename In>
+inline void readMeshlets(In &in, Geometry &obj, Uint32 size) {
+	Uint32 countMeshlets  = read32(in);
+	Uint32 countVertices  = read32(in);
+	Uint32 countTriangles = read32(in);
+	if (size != 12 + countMeshlets * 64ull + countVertices * 4ull + countTriangles * 3ull) {
+		throw Exception("Invalid meshlet section size.");
+	}
+	std::vector<Meshlet> meshlets(countMeshlets);
+	for (Uint32 i = 0; i < countMeshlets; i++) {
+		Meshlet &m = meshlets[i];
+		m.vertexOffset   = read32(in);
+		m.vertexCount    = read32(in);
+		m.triangleOffset = read32(in);
+		m.triangleCount  = read32(in);
+		m.elementOffset  = read32(in);
+		m.center = readVec3(in);
+		m.radius = readFloat(in, TYPE_FLOAT);
+		m.apex   = readVec3(in);
+		m.axis   = readVec3(in);
+		m.cutoff = readFloat(in, TYPE_FLOAT);
+		if (m.vertexOffset + Uint64(m.vertexCount) > countVertices) {
+			throw Exception("Invalid meshlet vertices.");
+		} else if (m.triangleOffset + Uint64(m.triangleCount) > countTriangles) {
+			throw Exception("Invalid meshlet triangles.");
+		}
+	}
+	std::vector<Uint32> vertices(countVertices);
+	std::vector<Uint8>  triangles(countTriangles * 3ull);
+	for (Uint32 i = 0; i < countVertices; i++) vertices[i] = read32(in);
+	for (std::size_t i = 0; i < triangles.size(); i++) triangles[i] = read8(in);
+	for (Uint32 i = 0; i < countMeshlets; i++) {
+		const Meshlet &m = meshlets[i];
+		obj.addMeshlet(m, vertices.data() + m.vertexOffset, triangles.data() + m.triangleOffset * 3ull);
+	}
+}
+
+inline void writeMeshlets(std::ostream &out, const Geometry &obj) {
+	size_type countMeshlets = obj.getMeshletCount();
+	const Meshlet &last = obj.getMeshlet(countMeshlets - 1);
+	size_type countVertices  = last.vertexOffset   + last.vertexCount;
+	size_type countTriangles = last.triangleOffset + last.triangleCount;
+	size_type size = 12 + countMeshlets * 64 + countVertices * 4 + countTriangles * 3;
+	if (size > 0xFFFFFFFF) {
+		throw Exception("Too many meshlets.");
+	}
+	write32(out, sectionMeshlets);
+	write32(out, size);
+	write32(out, countMeshlets);
+	write32(out, countVertices);
+	write32(out, countTriangles);
+	for (size_type i = 0; i < countMeshlets; i++) {
+		const Meshlet &m = obj.getMeshlet(i);
+		write32(out, m.vertexOffset);
+		write32(out, m.vertexCount);
+		write32(out, m.triangleOffset);
+		write32(out, m.triangleCount);
+		write32(out, m.elementOffset);
+		writeVec3 (out, m.center);
+		writeFloat(out, m.radius, TYPE_FLOAT);
+		writeVec3 (out, m.apex);
+		writeVec3 (out, m.axis);
+		writeFloat(out, m.cutoff, TYPE_FLOAT);
+	}
+	for (size_type i = 0; i < countVertices; i++) write32(out, obj.getMeshletVertex(i));
+	for (size_type i = 0; i < countTriangles * 3; i++) write8(out, obj.getMeshletTriangle(i));
+}
+
+size_type Geometry::fileHeaderSize() const
+{
+	return typeGetEncoding(typePosition) == encodingBounds ? headerSize + boundsSize : headerSize;
+}
+
+void Geometry::packFileHeader(Uint32 version, Uint32 countElements, Uint32 countVertices, Uint8 bytesPerElement, Uint8 *out) const
+{
+	Uint8 sizePosition = typeGetBytes(typePosition, 3);
+	Uint8 sizeTexcoord = typeGetBytes(typeTexcoord, 2);
+	Uint8 sizeNormal   = typeGetBytes(typeNormal,   3);
+	Uint8 sizeTangent  = typeGetBytes(typeTangent,  4);
+	
+	Uint8 offsetPosition = 0;
+	Uint8 offsetTexcoord = offsetPosition + sizePosition;
+	Uint8 offsetNormal   = offsetTexcoord + sizeTexcoord;
+	Uint8 offsetTangent  = offsetNormal   + sizeNormal;
+	
+	Uint8 bytesPerVertex =
+		sizePosition + sizeTexcoord +
+		sizeNormal   + sizeTangent;
+		
+	storeLittle(out, 0x47524643, 4);
+	storeLittle(out, version, 4);
+	storeLittle(out, countElements, 4);
+	storeLittle(out, countVertices, 4);
+	*out++ = bytesPerVertex;
+	*out++ = bytesPerElement;
+	
+	*out++ = offsetPosition;
+	*out++ = typePosition;
+	*out++ = offsetTexcoord;
+	*out++ = typeTexcoord;
+	*out++ = offsetNormal;
+	*out++ = typeNormal;
+	*out++ = offsetTangent;
+	*out++ = typeTangent;
+	for (int i = 0; i < 6; i++) *out++ = 0;
+	
+	if (typeGetEncoding(typePosition) == encodingBounds) {
+		const float bounds[6] = { boundsLow.x, boundsLow.y, boundsLow.z, boundsHigh.x, boundsHigh.y, boundsHigh.z };
+		for (int i = 0; i < 6; i++) storeLittle(out, packFull(bounds[i]), 4);
+	}
+}
+
+Uint8 Geometry::fileElementSize(Uint32 elementMax)
+{
+	Uint8 bytesPerElement = 4;
+	if (elementMax <= 0xFF )  bytesPerElement = 1;
+	if (elementMax <= 0xFFFF) bytesPerElement = 2;
+	return bytesPerElement;
+}
+
 std::istream& operator>>(std::istream& in, Geometry& obj)
 {
 	if (read32(in) != 0x47524643) {
 		throw Exception("Invalid magic number.");
-	} else if (read32(in) != 1) {
+	}
+	Uint32 version = read32(in);
+	if (version == 2) {
+		
+		/* Chunks are decoded from memory */
+		std::vector<Uint8> data;
+		Uint8 header[8];
+		Uint8 *pos = header;
+		storeLittle(pos, 0x47524643, 4);
+		storeLittle(pos, version,    4);
+		data.assign(header, header + 8);
+		data.insert(data.end(), std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		GeometryView view;
+		view.open(data.data(), data.size());
+		view.materialize(obj);
+		return in;
+		
+	} else if (version != 1) {
 		throw Exception("Invalid version.");
 	}
 	
@@ -314,17 +1075,25 @@ std::istream& operator>>(std::istream& in, Geometry& obj)
 	Uint8   typeNormal   = read8(in);
 	Uint8 offsetTangent  = read8(in);
 	Uint8   typeTangent  = read8(in);
-	in.ignore(4);
+	in.ignore(6);
 	
 	if (bytesPerElement == 0 || bytesPerElement == 3 || bytesPerElement > 4) {
 		throw Exception("Invalid bytes per element.");
 	}
 	
+	Vec3 boundsLow, boundsHigh;
+	if (typeGetEncoding(typePosition) == encodingBounds) {
+		boundsLow  = readVec3(in);
+		boundsHigh = readVec3(in);
+	}
+	
 	obj.clear();
+	obj.setBounds(boundsLow, boundsHigh);
 	obj.setTypePosition(typePosition);
 	obj.setTypeTexcoord(typeTexcoord);
 	obj.setTypeNormal  (typeNormal);
 	obj.setTypeTangent (typeTangent);
+	obj.setFileVersion (version);
 	obj.reserveElements(countElements);
 	obj.reserveVertices(countVertices);
 	
@@ -337,11 +1106,14 @@ std::istream& operator>>(std::istream& in, Geometry& obj)
 		vertex.texcoord.y = readFloat(in, typeTexcoord);
 		vertex.normal.x   = readFloat(in, typeNormal);
 		vertex.normal.y   = readFloat(in, typeNormal);
-		vertex.normal.z   = readFloat(in, typeNormal);
+		if (typeGetCount(typeNormal, 3) == 3) {
+			vertex.normal.z = readFloat(in, typeNormal);
+		}
 		vertex.tangent.x  = readFloat(in, typeTangent);
 		vertex.tangent.y  = readFloat(in, typeTangent);
 		vertex.tangent.z  = readFloat(in, typeTangent);
 		vertex.tangent.w  = readFloat(in, typeTangent);
+		decodeVertex(vertex, typePosition, typeNormal, typeTangent, boundsLow, boundsHigh);
 		obj.pushVertex(vertex);
 	}
 	
@@ -357,6 +1129,17 @@ std::istream& operator>>(std::istream& in, Geometry& obj)
 		break;
 	}
 	
+	/* Sections until the end, unknown ones are skipped */
+	while (in.peek() != std::istream::traits_type::eof()) {
+		Uint32 section = read32(in);
+		Uint32 size    = read32(in);
+		if (section == sectionMeshlets) {
+			readMeshlets(in, obj, size);
+		} else {
+			in.ignore(size);
+		}
+	}
+	
 	(void) bytesPerVertex;
 	(void) offsetPosition;
 	(void) offsetTexcoord;
@@ -374,78 +1157,424 @@ std::ostream& operator<<(std::ostream& out, const Geometry& obj)
 		throw Exception("Too many elements.");
 	}
 	
-	Uint8 sizePosition = 3 * typeGetSize(obj.typePosition);
-	Uint8 sizeTexcoord = 2 * typeGetSize(obj.typeTexcoord);
-	Uint8 sizeNormal   = 3 * typeGetSize(obj.typeNormal);
-	Uint8 sizeTangent  = 4 * typeGetSize(obj.typeTangent);
-	
-	Uint8 offsetPosition = 0;
-	Uint8 offsetTexcoord = offsetPosition + sizePosition;
-	Uint8 offsetNormal   = offsetTexcoord + sizeTexcoord;
-	Uint8 offsetTangent  = offsetNormal   + sizeNormal;
-	
 	Uint32 countElements   = obj.getElementCount();
 	Uint32 countVertices   = obj.getVertexCount();
-	Uint8  bytesPerVertex =
-		sizePosition + sizeTexcoord +
-		sizeNormal   + sizeTangent;
-	Uint8  bytesPerElement = 4;
+	Uint8  bytesPerElement = Geometry::fileElementSize(obj.getElementMax());
 	
-	if (obj.getElementMax() <= 0xFF )  bytesPerElement = 1;
-	if (obj.getElementMax() <= 0xFFFF) bytesPerElement = 2;
+	Uint8 header[Geometry::fileHeaderMaximum];
+	Uint32 headerBytes = obj.fileHeaderSize();
+	obj.packFileHeader(obj.fileVersion, countElements, countVertices, bytesPerElement, header);
+	out.write(reinterpret_cast<const char*>(header), headerBytes);
 	
-	write32(out, 0x47524643);
-	write32(out, 1);
-	write32(out, countElements);
-	write32(out, countVertices);
-	write8 (out, bytesPerVertex);
-	write8 (out, bytesPerElement);
+	if (obj.fileVersion == 2) {
+		writeChunks(out, obj, bytesPerElement, headerBytes);
+	} else {
+		writeVertices(out, obj);
+		switch (bytesPerElement) {
+		case 1: writeElements<1>(out, obj); break;
+		case 2: writeElements<2>(out, obj); break;
+		case 4: writeElements<4>(out, obj); break;
+		}
+	}
 	
-	write8 (out,   offsetPosition);
-	write8 (out, obj.typePosition);
-	write8 (out,   offsetTexcoord);
-	write8 (out, obj.typeTexcoord);
-	write8 (out,   offsetNormal);
-	write8 (out, obj.typeNormal);
-	write8 (out,   offsetTangent);
-	write8 (out, obj.typeTangent);
-	for (int i = 0; i < 6; i++) write8 (out, 0);
+	if (obj.getMeshletCount() > 0) writeMeshlets(out, obj);
 	
-	size_type vertexCount = obj.getVertexCount();
-	for (size_type i = 0; i < vertexCount; i++) {
-		const Vertex& vertex = obj.getVertex(i);
-		writeFloat(out, vertex.position.x, obj.typePosition);
-		writeFloat(out, vertex.position.y, obj.typePosition);
-		writeFloat(out, vertex.position.z, obj.typePosition);
-		writeFloat(out, vertex.texcoord.x, obj.typeTexcoord);
-		writeFloat(out, vertex.texcoord.y, obj.typeTexcoord);
-		writeFloat(out, vertex.normal.x,   obj.typeNormal);
-		writeFloat(out, vertex.normal.y,   obj.typeNormal);
-		writeFloat(out, vertex.normal.z,   obj.typeNormal);
-		writeFloat(out, vertex.tangent.x,  obj.typeTangent);
-		writeFloat(out, vertex.tangent.y,  obj.typeTangent);
-		writeFloat(out, vertex.tangent.z,  obj.typeTangent);
-		writeFloat(out, vertex.tangent.w,  obj.typeTangent);
+	return out;
+}
+
+
+
+/* Mapped views */
+
+inline Uint32 loadLittle(const Uint8 *in, Uint32 size) {
+	Uint32 v = 0;
+	for (Uint32 i = 0; i < size; i++) v |= static_cast<Uint32>(in[i]) << (i * 8);
+	return v;
+}
+
+inline const Uint8* attributeData(const Uint8 *vertex, Uint8 offset, Uint8 type) {
+	return type == TYPE_DISABLE ? vertex : vertex + offset;
+}
+
+inline void checkAttribute(Uint8 offset, Uint8 type, Uint32 components, Uint8 encoding, Uint8 bytesPerVertex, const char *name) {
+	if (!typeIsValid(type, encoding)) {
+		throw Exception("Invalid " + std::string(name) + " type.");
+	} else if (type != TYPE_DISABLE && offset + typeGetBytes(type, components) > bytesPerVertex) {
+		throw Exception("Invalid " + std::string(name) + " offset.");
+	}
+}
+
+Uint32 AttributeView::getPacked(size_type index, size_type component) const
+{
+	Uint32 size = typeGetSize(type);
+	return loadLittle(data + index * stride + component * size, size);
+}
+
+float AttributeView::get(size_type index, size_type component) const
+{
+	return unpackFloat(getPacked(index, component), type);
+}
+
+Uint32 ElementView::operator[](size_type index) const
+{
+	return loadLittle(data + index * size, static_cast<Uint32>(size));
+}
+
+/* Decode chunks into the version 1 blocks, taking chunks in turn on each thread.
+ * The first error is rethrown once every thread is joined, if a thread can't
+ * be started the ones that could take all the chunks. */
+inline void decodeChunks(const Uint8 *file, const std::vector<Chunk> &chunks, Uint8 bytesPerVertex, Uint8 bytesPerElement,
+	Uint8 *vertices, Uint8 *elements, unsigned threads) {
+	std::atomic<size_type> next(0);
+	std::vector<std::exception_ptr> errors(std::max(1u, threads));
+	auto worker = [&](unsigned t) {
+		std::vector<Uint32> triangles;
+		try {
+			for (size_type i = next++; i < chunks.size(); i = next++) {
+				const Chunk &chunk = chunks[i];
+				const Uint8 *data = file + chunk.offset;
+				if (chunk.block == blockVertices) {
+					Uint8 *out = vertices + size_type(chunk.first) * bytesPerVertex;
+					if (chunk.codec == codecRaw) {
+						std::copy(data, data + chunk.size, out);
+					} else {
+						decodeVertices(data, chunk.size, chunk.count, bytesPerVertex, out);
+					}
+				} else {
+					Uint8 *out = elements + size_type(chunk.first) * bytesPerElement;
+					if (chunk.codec == codecRaw) {
+						std::copy(data, data + chunk.size, out);
+					} else {
+						triangles.resize(chunk.count);
+						decodeTriangles(data, chunk.size, chunk.count, triangles.data());
+						Uint64 limit = Uint64(1) << (bytesPerElement * 8);
+						for (Uint32 element : triangles) {
+							if (element >= limit) throw Exception("Invalid triangle data.");
+							storeLittle(out, element, bytesPerElement);
+						}
+					}
+				}
+			}
+		} catch (...) {
+			errors[t] = std::current_exception();
+			next = chunks.size();
+		}
+	};
+	std::vector<std::thread> workers;
+	try {
+		for (unsigned t = 1; t < threads; t++) workers.push_back(std::thread(worker, t));
+	} catch (std::system_error&) {}
+	worker(0);
+	for (std::size_t t = 0; t < workers.size(); t++) workers[t].join();
+	for (const std::exception_ptr &error : errors) {
+		if (error) std::rethrow_exception(error);
+	}
+}
+
+GeometryView::GeometryView()
+: begin(nullptr), vertices(nullptr), elements(nullptr), meshlets(nullptr), meshletSize(0), version(0),
+  countVertices(0), countElements(0), bytesPerVertex(0), bytesPerElement(0),
+  offsetPosition(0), typePosition(TYPE_DISABLE), offsetTexcoord(0), typeTexcoord(TYPE_DISABLE),
+  offsetNormal(0), typeNormal(TYPE_DISABLE), offsetTangent(0), typeTangent(TYPE_DISABLE)
+{}
+
+void GeometryView::open(const std::string &file, unsigned threads)
+{
+	close();
+	if (!this->file.open(file)) {
+		throw Exception("IO error: Can't open " + file + ".");
+	}
+	parse(reinterpret_cast<const Uint8*>(this->file.data()), this->file.size(), threads);
+}
+
+void GeometryView::open(const Uint8 *data, size_type size, unsigned threads)
+{
+	close();
+	parse(data, size, threads);
+}
+
+void GeometryView::parse(const Uint8 *data, size_type size, unsigned threads)
+{
+	begin = data;
+	MemoryReader in = { data, data + size };
+	try {
+		
+		if (read32(in) != 0x47524643) {
+			throw Exception("Invalid magic number.");
+		}
+		version = read32(in);
+		if (version != 1 && version != 2) {
+			throw Exception("Invalid version.");
+		}
+		
+		countElements   = read32(in);
+		countVertices   = read32(in);
+		bytesPerVertex  = read8 (in);
+		bytesPerElement = read8 (in);
+		offsetPosition  = read8 (in);
+		typePosition    = read8 (in);
+		offsetTexcoord  = read8 (in);
+		typeTexcoord    = read8 (in);
+		offsetNormal    = read8 (in);
+		typeNormal      = read8 (in);
+		offsetTangent   = read8 (in);
+		typeTangent     = read8 (in);
+		for (int i = 0; i < 6; i++) read8(in);
+		
+		if (bytesPerElement == 0 || bytesPerElement == 3 || bytesPerElement > 4) {
+			throw Exception("Invalid bytes per element.");
+		}
+		checkAttribute(offsetPosition, typePosition, 3, encodingBounds,     bytesPerVertex, "position");
+		checkAttribute(offsetTexcoord, typeTexcoord, 2, encodingNone,       bytesPerVertex, "texcoord");
+		checkAttribute(offsetNormal,   typeNormal,   3, encodingOctahedral, bytesPerVertex, "normal");
+		checkAttribute(offsetTangent,  typeTangent,  4, encodingQTangent,   bytesPerVertex, "tangent");
+		if (typeGetEncoding(typePosition) == encodingBounds) {
+			boundsLow  = readVec3(in);
+			boundsHigh = readVec3(in);
+		}
+		
+		Uint64 sizeVertices = Uint64(countVertices) * bytesPerVertex;
+		Uint64 sizeElements = Uint64(countElements) * bytesPerElement;
+		if (version == 1) {
+			if (Uint64(in.end - in.pos) < sizeVertices + sizeElements) {
+				throw Exception("Unexpected end of file.");
+			}
+			vertices = in.pos;
+			elements = vertices + sizeVertices;
+			in.pos   = elements + sizeElements;
+		} else {
+			
+			/* Chunk table, blocks are covered in order */
+			Uint32 countChunks = read32(in);
+			if (Uint64(in.end - in.pos) < Uint64(countChunks) * chunkEntry) {
+				throw Exception("Unexpected end of file.");
+			}
+			std::vector<Chunk> chunks(countChunks);
+			Uint64 dataStart = (in.pos - data) + Uint64(countChunks) * chunkEntry;
+			Uint64 dataEnd   = dataStart;
+			Uint64 nextVertex = 0, nextElement = 0;
+			for (Chunk &chunk : chunks) {
+				chunk.block  = read8 (in);
+				chunk.codec  = read8 (in);
+				read16(in);
+				chunk.first  = read32(in);
+				chunk.count  = read32(in);
+				chunk.size   = read32(in);
+				chunk.offset = read32(in);
+				chunk.offset |= Uint64(read32(in)) << 32;
+				
+				Uint64 rawSize;
+				if (chunk.block == blockVertices && (chunk.codec == codecRaw || chunk.codec == codecVertices)) {
+					if (chunk.first != nextVertex) throw Exception("Invalid chunk.");
+					nextVertex += chunk.count;
+					rawSize = Uint64(chunk.count) * bytesPerVertex;
+				} else if (chunk.block == blockElements && (chunk.codec == codecRaw || chunk.codec == codecTriangles)) {
+					if (chunk.first != nextElement) throw Exception("Invalid chunk.");
+					nextElement += chunk.count;
+					rawSize = Uint64(chunk.count) * bytesPerElement;
+				} else {
+					throw Exception("Invalid chunk.");
+				}
+				if (chunk.codec == codecRaw && chunk.size != rawSize) {
+					throw Exception("Invalid chunk size.");
+				} else if (chunk.offset < dataStart || chunk.offset > size || size - chunk.offset < chunk.size) {
+					throw Exception("Invalid chunk offset.");
+				}
+				dataEnd = std::max(dataEnd, chunk.offset + chunk.size);
+			}
+			if (nextVertex != countVertices || nextElement != countElements) {
+				throw Exception("Invalid chunk count.");
+			}
+			
+			decodedVertices.resize(sizeVertices);
+			decodedElements.resize(sizeElements);
+			decodeChunks(data, chunks, bytesPerVertex, bytesPerElement, decodedVertices.data(), decodedElements.data(), threads);
+			vertices = decodedVertices.data();
+			elements = decodedElements.data();
+			in.pos   = data + dataEnd;
+		}
+		
+		/* Sections until the end, unknown ones are skipped */
+		while (in.pos != in.end) {
+			Uint32 section = read32(in);
+			Uint32 size    = read32(in);
+			if (Uint64(in.end - in.pos) < size) {
+				throw Exception("Invalid section size.");
+			}
+			if (section == sectionMeshlets) {
+				meshlets    = in.pos;
+				meshletSize = size;
+			}
+			in.pos += size;
+		}
+		
+	} catch (...) {
+		close();
+		throw;
+	}
+}
+
+void GeometryView::close()
+{
+	file.close();
+	begin = vertices = elements = meshlets = nullptr;
+	meshletSize = version = countVertices = countElements = 0;
+	bytesPerVertex = bytesPerElement = 0;
+	typePosition = typeTexcoord = typeNormal = typeTangent = TYPE_DISABLE;
+	boundsLow = boundsHigh = Vec3();
+	std::vector<Uint8>().swap(decodedVertices);
+	std::vector<Uint8>().swap(decodedElements);
+}
+
+bool GeometryView::isOpen() const
+{
+	return begin != nullptr;
+}
+
+Uint32 GeometryView::getVersion() const
+{
+	return version;
+}
+
+Vec3 GeometryView::getBoundsLow() const
+{
+	return boundsLow;
+}
+
+Vec3 GeometryView::getBoundsHigh() const
+{
+	return boundsHigh;
+}
+
+size_type GeometryView::getVertexCount() const
+{
+	return countVertices;
+}
+
+size_type GeometryView::getElementCount() const
+{
+	return countElements;
+}
+
+size_type GeometryView::getVertexSize() const
+{
+	return bytesPerVertex;
+}
+
+size_type GeometryView::getElementSize() const
+{
+	return bytesPerElement;
+}
+
+const Uint8* GeometryView::getVertexData() const
+{
+	return vertices;
+}
+
+const Uint8* GeometryView::getElementData() const
+{
+	return elements;
+}
+
+AttributeView GeometryView::attribute(Uint8 offset, Uint8 type) const
+{
+	AttributeView view;
+	if (type == TYPE_DISABLE) return view;
+	view.data   = vertices + offset;
+	view.stride = bytesPerVertex;
+	view.count  = countVertices;
+	view.type   = type;
+	return view;
+}
+
+AttributeView GeometryView::getPosition() const
+{
+	return attribute(offsetPosition, typePosition);
+}
+
+AttributeView GeometryView::getTexcoord() const
+{
+	return attribute(offsetTexcoord, typeTexcoord);
+}
+
+AttributeView GeometryView::getNormal() const
+{
+	return attribute(offsetNormal, typeNormal);
+}
+
+AttributeView GeometryView::getTangent() const
+{
+	return attribute(offsetTangent, typeTangent);
+}
+
+ElementView GeometryView::getElements() const
+{
+	ElementView view;
+	view.data  = elements;
+	view.size  = bytesPerElement;
+	view.count = countElements;
+	return view;
+}
+
+Vertex GeometryView::getVertex(size_type index) const
+{
+	const Uint8 *vertex   = vertices + index * bytesPerVertex;
+	const Uint8 *position = attributeData(vertex, offsetPosition, typePosition);
+	const Uint8 *texcoord = attributeData(vertex, offsetTexcoord, typeTexcoord);
+	const Uint8 *normal   = attributeData(vertex, offsetNormal,   typeNormal);
+	const Uint8 *tangent  = attributeData(vertex, offsetTangent,  typeTangent);
+	Vertex v;
+	loadAttribute(position, v.position.x, v.position.packX, typePosition);
+	loadAttribute(position, v.position.y, v.position.packY, typePosition);
+	loadAttribute(position, v.position.z, v.position.packZ, typePosition);
+	loadAttribute(texcoord, v.texcoord.x, v.texcoord.packX, typeTexcoord);
+	loadAttribute(texcoord, v.texcoord.y, v.texcoord.packY, typeTexcoord);
+	loadAttribute(normal,   v.normal.x,   v.normal.packX,   typeNormal);
+	loadAttribute(normal,   v.normal.y,   v.normal.packY,   typeNormal);
+	if (typeGetCount(typeNormal, 3) == 3) {
+		loadAttribute(normal, v.normal.z, v.normal.packZ, typeNormal);
+	}
+	loadAttribute(tangent,  v.tangent.x,  v.tangent.packX,  typeTangent);
+	loadAttribute(tangent,  v.tangent.y,  v.tangent.packY,  typeTangent);
+	loadAttribute(tangent,  v.tangent.z,  v.tangent.packZ,  typeTangent);
+	loadAttribute(tangent,  v.tangent.w,  v.tangent.packW,  typeTangent);
+	decodeVertex(v, typePosition, typeNormal, typeTangent, boundsLow, boundsHigh);
+	return v;
+}
+
+void GeometryView::materialize(Geometry &obj) const
+{
+	if (!isOpen()) {
+		throw Exception("Geometry view isn't open.");
 	}
 	
-	size_type elementCount = obj.getElementCount();
+	obj.clear();
+	obj.setBounds(boundsLow, boundsHigh);
+	obj.setTypePosition(typePosition);
+	obj.setTypeTexcoord(typeTexcoord);
+	obj.setTypeNormal  (typeNormal);
+	obj.setTypeTangent (typeTangent);
+	obj.setFileVersion (version);
+	obj.reserveElements(countElements);
+	obj.reserveVertices(countVertices);
+	
+	for (Uint32 i = 0; i < countVertices; i++) obj.pushVertex(getVertex(i));
+	
+	const Uint8 *in = elements;
 	switch (bytesPerElement) {
 	case 1:
-		for (size_type i = 0; i < elementCount; i++) {
-			write8(out, obj.getElement(i));
-		}
+		for (Uint32 i = 0; i < countElements; i++, in += 1) obj.addElement(loadLittle(in, 1));
 		break;
 	case 2:
-		for (size_type i = 0; i < elementCount; i++) {
-			write16(out, obj.getElement(i));
-		}
+		for (Uint32 i = 0; i < countElements; i++, in += 2) obj.addElement(loadLittle(in, 2));
 		break;
 	case 4:
-		for (size_type i = 0; i < elementCount; i++) {
-			write32(out, obj.getElement(i));
-		}
+		for (Uint32 i = 0; i < countElements; i++, in += 4) obj.addElement(loadLittle(in, 4));
 		break;
 	}
 	
-	return out;
+	if (meshlets) {
+		MemoryReader section = { meshlets, meshlets + meshletSize };
+		readMeshlets(section, obj, meshletSize);
+	}
 }
@@ -4,9 +4,11 @@
 
 #include "Common.hpp"
 #include "BaseGeometry.hpp"
+#include "../MappedFile.hpp"
 #include <string>
 #include <istream>
 #include <ostream>
+#include <vector>
 
 std::istream& operator>>(std::istream& in, CFR::Geometry& obj);
 std::ostream& operator<<(std::ostream& out, const CFR::Geometry& obj);
@@ -28,6 +30,16 @@ namespace CFR {
 	static const Uint8 TYPE_NORM_BYTE           = 0b10000000;
 	static const Uint8 TYPE_NORM_UNSIGNED_BYTE  = 0b10000001;
 	
+	/* Normal and tangent encodings */
+	static const Uint8 TYPE_OCT_NORM_BYTE       = 0b11000000; // Normal, 2 octahedral components
+	static const Uint8 TYPE_OCT_NORM_SHORT      = 0b11000010;
+	static const Uint8 TYPE_QTANGENT_NORM_BYTE  = 0b10100000; // Tangent frame quaternion
+	static const Uint8 TYPE_QTANGENT_NORM_SHORT = 0b10100010;
+	
+	/* Position encodings */
+	static const Uint8 TYPE_BOUNDS_NORM_UNSIGNED_BYTE  = 0b11100001; // Position within the bounds
+	static const Uint8 TYPE_BOUNDS_NORM_UNSIGNED_SHORT = 0b11100011;
+	
 	
 	
 	/* CFR Geometry */
@@ -38,15 +50,23 @@ namespace CFR {
 		Geometry();
 		Geometry(const BaseGeometry &copy);
 		
-		/* Load/Save geometry - throws CFR::Exception */
-		void loadFromFile(const std::string &file);
+		/* Load/Save geometry, loading maps the file and decodes version 2
+		 * chunks on threads - throws CFR::Exception */
+		void loadFromFile(const std::string &file, unsigned threads = 1);
 		void   saveToFile(const std::string &file) const;
 		
+		/* File version written, 1 raw or 2 chunked, loading sets the file's - throws CFR::Exception */
+		void setFileVersion(Uint32 version);
+		Uint32 getFileVersion() const;
+		
 		/* Override vertex insertion */
 		Uint32 pushVertex(const Vertex &v) override;
 		Uint32 addVertex (const Vertex &v) override;
 		
-		/* Set attribute export type */
+		/* Set attribute export type, packed vertices are recompressed.
+		 * Octahedral types are for normals, QTangent types for tangents,
+		 * a QTangent also carries the normal if the normal is disabled.
+		 * Bounds types are for positions, fit the bounds first. */
 		void setTypePosition(Uint8 type);
 		void setTypeTexcoord(Uint8 type);
 		void setTypeNormal  (Uint8 type);
@@ -58,9 +78,24 @@ namespace CFR {
 		Uint8 getTypeNormal()   const;
 		Uint8 getTypeTangent()  const;
 		
+		/* Bytes per vertex in the file */
+		size_type getVertexSize() const;
+		
+		/* Bounds of bounds quantized positions, positions outside are
+		 * clamped, packed vertices are recompressed */
+		void setBounds(const Vec3 &low, const Vec3 &high);
+		void fitBounds(); // To the current vertices
+		Vec3 getBoundsLow()  const;
+		Vec3 getBoundsHigh() const;
+		
+		/* Largest error of bounds quantized positions in world units,
+		 * half a step on each axis, 0 for other position types */
+		float getPositionError() const;
+		
 		/* Stream insertion/extraction */
 		friend std::istream& ::operator>>(std::istream&, Geometry &obj);
 		friend std::ostream& ::operator<<(std::ostream&, const Geometry &obj);
+		friend class GeometryBuilder;
 		
 	private:
 		
@@ -69,8 +104,123 @@ namespace CFR {
 		Uint8 typeNormal   = TYPE_HALF_FLOAT;
 		Uint8 typeTangent  = TYPE_HALF_FLOAT;
 		Uint8 typeBinormal = TYPE_HALF_FLOAT;
+		Uint32 fileVersion = 1;
+		Vec3 boundsLow;
+		Vec3 boundsHigh;
+		
+		Vertex compressVertex(Vertex v) const override;
+		
+		/* Packed vertices use the file layout */
+		size_type packedSize() const override;
+		void   packVertex  (const Vertex &v, Uint8 *out) const override;
+		Vertex unpackVertex(const Uint8 *in) const override;
+		
+		/* File header with the attribute layout, followed by the bounds of
+		 * bounds encoded positions. Packs fileHeaderSize() bytes into out. */
+		static const size_type fileHeaderMaximum = 56;
+		size_type fileHeaderSize() const;
+		void packFileHeader(Uint32 version, Uint32 countElements, Uint32 countVertices, Uint8 bytesPerElement, Uint8 *out) const;
+		
+		/* Bytes per element in the file */
+		static Uint8 fileElementSize(Uint32 elementMax);
+		
+	};
+	
+	
+	
+	/* Packed values of one attribute in a mapped file, octahedral normals,
+	 * QTangents and bounds quantized positions give their encoded components */
+	struct AttributeView {
+		const Uint8 *data = nullptr; // First component of the first vertex
+		size_type stride = 0;        // Bytes between vertices
+		size_type count  = 0;        // Vertices, 0 if the attribute isn't used
+		Uint8     type   = TYPE_DISABLE;
+		Uint32 getPacked(size_type index, size_type component) const;
+		float  get      (size_type index, size_type component) const;
+	};
+	
+	/* Elements in a mapped file */
+	struct ElementView {
+		const Uint8 *data = nullptr;
+		size_type size  = 0; // Bytes per element
+		size_type count = 0;
+		Uint32 operator[](size_type index) const;
+	};
+	
+	
+	
+	/* Memory-mapped CFR Geometry file. The header and section sizes are
+	 * validated on open, version 1 vertex and element blocks are used in
+	 * place, version 2 chunks are decoded into memory on open.
+	 * Elements aren't range checked until materialize(). */
+	class GeometryView {
+	public:
+		
+		GeometryView();
+		
+		/* Map and validate the file - throws CFR::Exception */
+		void open(const std::string &file, unsigned threads = 1);
+		
+		/* File already in memory, data must outlive the view - throws CFR::Exception */
+		void open(const Uint8 *data, size_type size, unsigned threads = 1);
+		
+		void close();
+		bool isOpen() const;
+		Uint32 getVersion() const;
+		Vec3 getBoundsLow()  const; // Of bounds quantized positions
+		Vec3 getBoundsHigh() const;
+		
+		/* Blocks, little endian in the version 1 layout */
+		size_type getVertexCount()  const;
+		size_type getElementCount() const;
+		size_type getVertexSize()   const; // Bytes per vertex
+		size_type getElementSize()  const; // Bytes per element
+		const Uint8* getVertexData()  const;
+		const Uint8* getElementData() const;
+		
+		/* Typed views */
+		AttributeView getPosition() const;
+		AttributeView getTexcoord() const;
+		AttributeView getNormal()   const;
+		AttributeView getTangent()  const;
+		ElementView   getElements() const;
+		
+		/* Decode a single vertex */
+		Vertex getVertex(size_type index) const;
+		
+		/* Copy into an editable geometry - throws CFR::Exception */
+		void materialize(Geometry &geometry) const;
 		
-		Vertex compressVertex(Vertex v);
+	private:
+		
+		GeometryView(const GeometryView&) = delete;
+		GeometryView& operator=(const GeometryView&) = delete;
+		
+		MappedFile file;
+		const Uint8 *begin; // File data, nullptr if closed
+		const Uint8 *vertices;
+		const Uint8 *elements;
+		const Uint8 *meshlets; // Meshlet section data, nullptr if there is none
+		Uint32 meshletSize;
+		Uint32 version;
+		Uint32 countVertices;
+		Uint32 countElements;
+		Uint8  bytesPerVertex;
+		Uint8  bytesPerElement;
+		Uint8  offsetPosition, typePosition;
+		Uint8  offsetTexcoord, typeTexcoord;
+		Uint8  offsetNormal,   typeNormal;
+		Uint8  offsetTangent,  typeTangent;
+		Vec3   boundsLow, boundsHigh;
+		
+		/* Version 2 blocks */
+		std::vector<Uint8> decodedVertices;
+		std::vector<Uint8> decodedElements;
+		
+		/* Validate the header and sections, decode chunks - throws CFR::Exception */
+		void parse(const Uint8 *data, size_type size, unsigned threads);
+		
+		AttributeView attribute(Uint8 offset, Uint8 type) const;
 		
 	};
 	
@@ -81,7 +231,7 @@ namespace CFR {
 		Byte order: little endian
 		
 		Uint32 magic = 0x47524643; // CFRG
-		Uint32 version = 1;
+		Uint32 version = 1;       // Or 2, see Chunks
 		Uint32 countElements;     // Number of elements
 		Uint32 countVertices;     // Number of vertices
 		Uint8  bytesPerVertex;    // Bytes per vertex
@@ -91,18 +241,81 @@ namespace CFR {
 		Uint8  attribNormal  [2]; // Vertex normal   (3 dimensions)
 		Uint8  attribTangent [2]; // Vertex tangent  (4 dimensions)
 		Uint8  unused[6];
+		float  bounds[6];         // Only with a bounds position type: low xyz, high xyz
 		Uint8  vertices[countVertices * bytesPerVertex ];
 		Uint8  elements[countElements * bytesPerElement];
+		Section sections[];       // Optional, until the end of the file
 		
+		Chunks, version 2 replaces vertices and elements with:
+			Uint32 countChunks;
+			Chunk  chunks[countChunks];
+			Uint8  data[];            // Chunk data, sections follow the last chunk
+			
+		Chunk:
+			Uint8  block;  // 0 - Vertices, 1 - Elements
+			Uint8  codec;  // 0 - Raw, 1 - Vertex byte planes, 2 - Triangles
+			Uint16 unused;
+			Uint32 first;  // First vertex or element
+			Uint32 count;  // Vertices or elements
+			Uint32 size;   // Bytes of data
+			Uint64 offset; // Data from the start of the file
+			Chunks of a block follow each other from 0 to the block count,
+			each one decodes on its own into the version 1 layout
+			
+		Chunk codecs:
+			0 - Raw, as in version 1
+			1 - Byte planes, for each byte of a vertex: delta from the same byte
+			    of the previous vertex, zigzagged, groups of 16 bit packed at
+			    0, 2, 4 or 8 bits with 2 bit group widths first
+			2 - Triangles, edge and vertex FIFO codes, see CFR/Codec.cpp
+			
+		Section:
+			Uint32 tag;
+			Uint32 size;
+			Uint8  data[size];
+			Readers skip sections with unknown tags
+			
+		Meshlet section:
+			Uint32 tag = 0x4C48534D; // MSHL
+			Uint32 countMeshlets;
+			Uint32 countVertices;
+			Uint32 countTriangles;
+			Meshlet meshlets[countMeshlets];
+			Uint32 vertices [countVertices];      // Geometry vertices
+			Uint8  triangles[countTriangles * 3]; // Meshlet vertices
+			
+		Meshlet:
+			Uint32 vertexOffset, vertexCount;     // Meshlet vertex range
+			Uint32 triangleOffset, triangleCount; // Meshlet triangle range
+			Uint32 elementOffset;                 // Same triangles in elements
+			float  center[3], radius;             // Bounding sphere
+			float  apex[3], axis[3], cutoff;      // Normal cone
+			Backfacing if dot(normalize(apex - camera), axis) >= cutoff
+			
 		Attributes:
 			attribute[0] = Byte offset within a vertex
 			attribute[1] = Attribute type
 			If offset or type is 0xFF, the attribute isn't used
-		
+			
 		Attribute type:
 			Normalize     = type & 0b10000000
-			Variable type = type & 0b01111111
-		
+			Encoding      = type & 0b01100000
+			Variable type = type & 0b00011111
+			
+		Attribute encodings:
+			0b00000000 - Components as they are
+			0b01000000 - Octahedral normal, 2 normalized signed components
+			             z = 1 - |x| - |y|, if z < 0:
+			             x, y = (1 - |y|) * sign(x), (1 - |x|) * sign(y)
+			             normal = normalize(x, y, z)
+			0b00100000 - QTangent, 4 normalized signed components x, y, z, w
+			             Rotation of the frame with columns tangent,
+			             cross(normal, tangent) and normal. w is kept away
+			             from 0, negative w means tangent.w = -1.
+			             If the normal is disabled, it comes from the QTangent.
+			0b01100000 - Position within the bounds, 3 normalized unsigned
+			             components, position = low + x * (high - low)
+			
 		Attribute variable types:
 			0  - Signed   byte  (GL_BYTE)
 			1  - Unsigned byte  (GL_UNSIGNED_BYTE)
@@ -113,11 +326,11 @@ namespace CFR {
 			6  - Float          (GL_FLOAT)
 			10 - Double         (GL_DOUBLE)
 			11 - Half float     (GL_HALF_FLOAT)
-		
+			
 		Tangent space:
 			Fourth tangent dimension is either 1 or -1
 			Binormal = cross(tangent.xyz, normal) * tangent.w
-		
+			
 	*/
 	
 	
@@ -0,0 +1,480 @@
+#include "GeometryBuilder.hpp"
+#include <algorithm> // std::sort, std::min, std::max
+#include <cstring> // std::memcmp, std::memcpy
+#include <cstdio> // std::remove
+#include <memory> // std::unique_ptr
+#include <queue> // std::priority_queue
+#include <sstream>
+#include <vector>
+
+using CFR::GeometryBuilder;
+using CFR::Geometry;
+using CFR::size_type;
+using CFR::Uint8;
+using CFR::Uint32;
+using CFR::Uint64;
+using CFR::Vertex;
+using CFR::Exception;
+
+static const size_type recordBlock  = 1 << 16; // Smallest read block of a run
+static const size_type maximumRuns  = 64;      // Runs merged at once
+static const size_type vertexFloats = 12;      // Raw vertex record
+
+
+
+/* Records */
+
+/* Keys are big endian so records sort by their bytes */
+inline void putKey(Uint8 *out, Uint32 v) {
+	out[0] = static_cast<Uint8>(v >> 24);
+	out[1] = static_cast<Uint8>(v >> 16);
+	out[2] = static_cast<Uint8>(v >> 8);
+	out[3] = static_cast<Uint8>(v >> 0);
+}
+
+inline Uint32 getKey(const Uint8 *in) {
+	return (static_cast<Uint32>(in[0]) << 24) | (static_cast<Uint32>(in[1]) << 16)
+	     | (static_cast<Uint32>(in[2]) << 8)  | (static_cast<Uint32>(in[3]) << 0);
+}
+
+inline void putLittle(Uint8 *out, Uint32 v, size_type bytes) {
+	for (size_type i = 0; i < bytes; i++) out[i] = static_cast<Uint8>(v >> (i * 8));
+}
+
+inline std::string tempName(const std::string &prefix, size_type index) {
+	std::ostringstream os;
+	os << prefix << "." << index << ".tmp";
+	return os.str();
+}
+
+inline void openRead(std::ifstream &in, const std::string &file) {
+	in.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+	in.open(file, std::ios::binary);
+}
+
+inline void openWrite(std::ofstream &out, const std::string &file) {
+	out.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+	out.open(file, std::ios::binary | std::ios::trunc);
+}
+
+inline void writeRaw(std::ofstream &out, const Vertex &v) {
+	float f[vertexFloats] = {
+		v.position.x, v.position.y, v.position.z,
+		v.texcoord.x, v.texcoord.y,
+		v.normal.x,   v.normal.y,   v.normal.z,
+		v.tangent.x,  v.tangent.y,  v.tangent.z, v.tangent.w
+	};
+	out.write(reinterpret_cast<const char*>(f), sizeof(f));
+}
+
+inline Vertex readRaw(std::ifstream &in) {
+	float f[vertexFloats];
+	in.read(reinterpret_cast<char*>(f), sizeof(f));
+	Vertex v;
+	v.position.x = f[0]; v.position.y = f[1]; v.position.z = f[2];
+	v.texcoord.x = f[3]; v.texcoord.y = f[4];
+	v.normal.x   = f[5]; v.normal.y   = f[6]; v.normal.z   = f[7];
+	v.tangent.x  = f[8]; v.tangent.y  = f[9]; v.tangent.z  = f[10]; v.tangent.w = f[11];
+	return v;
+}
+
+/* External merge sort */
+
+/* Buffered reader of one sorted run */
+struct RunReader {
+	std::ifstream in;
+	std::vector<Uint8> block;
+	size_type recordSize;
+	size_type position = 0;
+	size_type size     = 0;
+	Uint64    left;
+	
+	RunReader(const std::string &file, size_type recordSize, Uint64 count, size_type memory)
+	: block(std::max(recordSize, memory / recordSize * recordSize)), recordSize(recordSize), left(count) {
+		openRead(in, file);
+		fill();
+	}
+	
+	const Uint8* peek() const {
+		return &block[position];
+	}
+	
+	bool pop() {
+		position += recordSize;
+		return position < size || fill();
+	}
+	
+	bool fill() {
+		if (left == 0) return false;
+		size_type count = static_cast<size_type>(std::min<Uint64>(left, block.size() / recordSize));
+		in.read(reinterpret_cast<char*>(block.data()), count * recordSize);
+		left    -= count;
+		size     = count * recordSize;
+		position = 0;
+		return true;
+	}
+};
+
+/* Min-heap order of run readers */
+struct RunOrder {
+	size_type recordSize;
+	bool operator()(const RunReader *a, const RunReader *b) const {
+		return std::memcmp(a->peek(), b->peek(), recordSize) > 0;
+	}
+};
+
+/* Fixed size records sorted by their bytes. Records past the memory given
+ * are spilled as sorted runs and merged when read back. Records are kept
+ * in blocks allocated as they fill, memory is freed once read. */
+class RecordSorter {
+public:
+	
+	RecordSorter(const std::string &prefix, size_type recordSize, size_type memory)
+	: prefix(prefix), recordSize(recordSize), heap(RunOrder{recordSize}), record(recordSize) {
+		capacity = std::max<size_type>(1, memory / (recordSize + sizeof(Uint32)));
+		perBlock = std::min(capacity, std::max<size_type>(1, recordBlock / recordSize));
+		capacity -= capacity % perBlock;
+	}
+	
+	~RecordSorter() {
+		readers.clear();
+		for (size_type i = 0; i < runs.size(); i++) std::remove(runs[i].file.c_str());
+	}
+	
+	void add(const Uint8 *data) {
+		if (count == capacity) spill();
+		if (count == blocks.size() * perBlock) blocks.push_back(std::vector<Uint8>(perBlock * recordSize));
+		std::memcpy(at(count++), data, recordSize);
+	}
+	
+	/* Start reading with memory, records that don't fit are read back from disk */
+	void start(size_type memory) {
+		if (runs.empty() && count * (recordSize + sizeof(Uint32)) <= memory) {
+			sortBuffer();
+			return;
+		}
+		if (count > 0) spill();
+		release();
+		
+		/* Too many runs for one pass, merge the oldest into a new one */
+		size_type fanIn = std::max<size_type>(2, std::min(maximumRuns, memory / recordBlock));
+		while (runs.size() > fanIn) {
+			Run merged;
+			merged.file  = tempName(prefix, created++);
+			merged.count = 0;
+			std::ofstream out;
+			openWrite(out, merged.file);
+			open(fanIn, memory);
+			for (const Uint8 *data = pop(); data; data = pop()) {
+				out.write(reinterpret_cast<const char*>(data), recordSize);
+				merged.count++;
+			}
+			out.close();
+			readers.clear();
+			for (size_type i = 0; i < fanIn; i++) std::remove(runs[i].file.c_str());
+			runs.erase(runs.begin(), runs.begin() + fanIn);
+			runs.push_back(merged);
+		}
+		open(runs.size(), memory);
+	}
+	
+	/* Next record in order, nullptr at the end */
+	const Uint8* next() {
+		if (!runs.empty()) return pop();
+		if (current < order.size()) return at(order[current++]);
+		release();
+		return nullptr;
+	}
+	
+	size_type getRuns() const {
+		return created;
+	}
+	
+private:
+	
+	struct Run {
+		std::string file;
+		Uint64      count;
+	};
+	
+	std::string prefix;
+	size_type recordSize;
+	size_type capacity; // Records in memory before a spill
+	size_type perBlock; // Records per block
+	size_type count = 0;
+	std::vector<std::vector<Uint8>> blocks;
+	std::vector<Uint32> order;
+	size_type current = 0;
+	std::vector<Run> runs;
+	size_type created = 0;
+	std::vector<std::unique_ptr<RunReader>> readers;
+	std::priority_queue<RunReader*, std::vector<RunReader*>, RunOrder> heap;
+	std::vector<Uint8> record;
+	
+	Uint8* at(size_type index) {
+		return blocks[index / perBlock].data() + index % perBlock * recordSize;
+	}
+	
+	void release() {
+		std::vector<std::vector<Uint8>>().swap(blocks);
+		std::vector<Uint32>().swap(order);
+		count = current = 0;
+	}
+	
+	void sortBuffer() {
+		order.resize(count);
+		for (size_type i = 0; i < count; i++) order[i] = static_cast<Uint32>(i);
+		std::sort(order.begin(), order.end(), [this](Uint32 a, Uint32 b) {
+			return std::memcmp(at(a), at(b), recordSize) < 0;
+		});
+		current = 0;
+	}
+	
+	void spill() {
+		sortBuffer();
+		Run run;
+		run.file  = tempName(prefix, created++);
+		run.count = order.size();
+		std::ofstream out;
+		openWrite(out, run.file);
+		for (size_type i = 0; i < order.size(); i++) {
+			out.write(reinterpret_cast<const char*>(at(order[i])), recordSize);
+		}
+		out.close();
+		runs.push_back(run);
+		count = 0;
+		order.clear();
+	}
+	
+	/* Merge the first count runs */
+	void open(size_type count, size_type memory) {
+		readers.clear();
+		heap = std::priority_queue<RunReader*, std::vector<RunReader*>, RunOrder>(RunOrder{recordSize});
+		for (size_type i = 0; i < count; i++) {
+			readers.push_back(std::unique_ptr<RunReader>(new RunReader(runs[i].file, recordSize, runs[i].count, memory / count)));
+			if (runs[i].count > 0) heap.push(readers.back().get());
+		}
+	}
+	
+	const Uint8* pop() {
+		if (heap.empty()) return nullptr;
+		RunReader *reader = heap.top();
+		heap.pop();
+		std::memcpy(record.data(), reader->peek(), recordSize);
+		if (reader->pop()) heap.push(reader);
+		return record.data();
+	}
+	
+};
+
+
+
+/* GeometryBuilder */
+
+GeometryBuilder::GeometryBuilder(const Geometry &layout, const std::string &file, size_type memoryBudget)
+: layout(layout), file(file), memoryBudget(memoryBudget)
+{
+	try {
+		openWrite(vertices, file + ".vertices.tmp");
+		openWrite(elements, file + ".elements.tmp");
+	} catch (std::ios::failure &fail) {
+		throw Exception("IO error: " + std::string(fail.what()));
+	}
+}
+
+GeometryBuilder::~GeometryBuilder()
+{
+	if (vertices.is_open()) vertices.close();
+	if (elements.is_open()) elements.close();
+	std::remove((file + ".vertices.tmp").c_str());
+	std::remove((file + ".elements.tmp").c_str());
+}
+
+Uint32 GeometryBuilder::addVertex(const Vertex &v)
+{
+	if (finished) {
+		throw Exception("Geometry already finished.");
+	} else if (countVertices >= 0xFFFFFFFF) {
+		throw Exception("Too many vertices.");
+	}
+	try {
+		writeRaw(vertices, v);
+	} catch (std::ios::failure &fail) {
+		throw Exception("IO error: " + std::string(fail.what()));
+	}
+	return static_cast<Uint32>(countVertices++);
+}
+
+void GeometryBuilder::addElement(Uint32 element)
+{
+	if (finished) {
+		throw Exception("Geometry already finished.");
+	} else if (element >= countVertices) {
+		throw Exception("Element out of range.");
+	} else if (countElements >= 0xFFFFFFFF) {
+		throw Exception("Too many elements.");
+	}
+	try {
+		elements.write(reinterpret_cast<const char*>(&element), sizeof(element));
+	} catch (std::ios::failure &fail) {
+		throw Exception("IO error: " + std::string(fail.what()));
+	}
+	countElements++;
+}
+
+void GeometryBuilder::finish()
+{
+	if (finished) {
+		throw Exception("Geometry already finished.");
+	}
+	finished = true;
+	
+	try {
+		vertices.close();
+		elements.close();
+		
+		/* At most three sorters are alive in a pass, each gets a third of the
+		 * budget. The first and last pass have one, which gets all of it. */
+		size_type stride = layout.getVertexSize();
+		size_type part   = memoryBudget / 3;
+		std::vector<Uint8> record(stride + 4);
+		std::vector<Uint8> last(stride);
+		
+		/* Packed vertices with their provisional index, sorted by bytes */
+		std::unique_ptr<RecordSorter> sorted(new RecordSorter(file + ".sorted", stride + 4, memoryBudget));
+		{
+			std::ifstream in;
+			openRead(in, file + ".vertices.tmp");
+			for (size_type i = 0; i < countVertices; i++) {
+				layout.packVertex(layout.compressVertex(readRaw(in)), record.data());
+				putKey(record.data() + stride, static_cast<Uint32>(i));
+				sorted->add(record.data());
+			}
+		}
+		std::remove((file + ".vertices.tmp").c_str());
+		
+		/* The first of equal vertices stands for them, as in addVertex */
+		std::unique_ptr<RecordSorter> uniques(new RecordSorter(file + ".uniques", 4 + stride, part));
+		std::unique_ptr<RecordSorter> owners (new RecordSorter(file + ".owners",  8, part));
+		sorted->start(part);
+		Uint32 first = 0;
+		for (const Uint8 *data = sorted->next(); data; data = sorted->next()) {
+			Uint32 index = getKey(data + stride);
+			if (countUnique == 0 || std::memcmp(data, last.data(), stride) != 0) {
+				first = index;
+				std::memcpy(last.data(), data, stride);
+				putKey(record.data(), first);
+				std::memcpy(record.data() + 4, data, stride);
+				uniques->add(record.data());
+				countUnique++;
+			}
+			putKey(record.data() + 0, first);
+			putKey(record.data() + 4, index);
+			owners->add(record.data());
+		}
+		countRuns += sorted->getRuns();
+		sorted.reset();
+		
+		/* Header is written last, when the element size is known */
+		std::ofstream out;
+		openWrite(out, file);
+		Uint8 header[Geometry::fileHeaderMaximum] = {};
+		size_type headerBytes = layout.fileHeaderSize();
+		out.write(reinterpret_cast<const char*>(header), headerBytes);
+		
+		/* Vertices in order of first use, each provisional index learns its output index */
+		std::unique_ptr<RecordSorter> finals(new RecordSorter(file + ".finals", 8, part));
+		uniques->start(part);
+		owners->start(part);
+		const Uint8 *owner = owners->next();
+		Uint32 output = 0;
+		for (const Uint8 *data = uniques->next(); data; data = uniques->next(), output++) {
+			out.write(reinterpret_cast<const char*>(data + 4), stride);
+			for (; owner && getKey(owner) == getKey(data); owner = owners->next()) {
+				putKey(record.data() + 0, getKey(owner + 4));
+				putKey(record.data() + 4, output);
+				finals->add(record.data());
+			}
+		}
+		countRuns += uniques->getRuns() + owners->getRuns();
+		uniques.reset();
+		owners.reset();
+		
+		/* Elements by provisional index */
+		std::unique_ptr<RecordSorter> byIndex(new RecordSorter(file + ".byindex", 8, part));
+		{
+			std::ifstream in;
+			openRead(in, file + ".elements.tmp");
+			for (size_type i = 0; i < countElements; i++) {
+				Uint32 element;
+				in.read(reinterpret_cast<char*>(&element), sizeof(element));
+				putKey(record.data() + 0, element);
+				putKey(record.data() + 4, static_cast<Uint32>(i));
+				byIndex->add(record.data());
+			}
+		}
+		std::remove((file + ".elements.tmp").c_str());
+		
+		/* Join with the output indices, back in element order */
+		std::unique_ptr<RecordSorter> byPosition(new RecordSorter(file + ".byposition", 8, part));
+		finals->start(part);
+		byIndex->start(part);
+		const Uint8 *final = finals->next();
+		Uint32 elementMax = 0;
+		for (const Uint8 *data = byIndex->next(); data; data = byIndex->next()) {
+			while (getKey(final) != getKey(data)) final = finals->next();
+			Uint32 element = getKey(final + 4);
+			elementMax = std::max(elementMax, element);
+			putKey(record.data() + 0, getKey(data + 4));
+			putKey(record.data() + 4, element);
+			byPosition->add(record.data());
+		}
+		countRuns += finals->getRuns() + byIndex->getRuns();
+		finals.reset();
+		byIndex.reset();
+		
+		Uint8 bytesPerElement = Geometry::fileElementSize(elementMax);
+		byPosition->start(memoryBudget);
+		for (const Uint8 *data = byPosition->next(); data; data = byPosition->next()) {
+			Uint8 element[4];
+			putLittle(element, getKey(data + 4), bytesPerElement);
+			out.write(reinterpret_cast<const char*>(element), bytesPerElement);
+		}
+		countRuns += byPosition->getRuns();
+		byPosition.reset();
+		
+		/* Header */
+		layout.packFileHeader(1, static_cast<Uint32>(countElements), static_cast<Uint32>(countUnique), bytesPerElement, header);
+		out.seekp(0);
+		out.write(reinterpret_cast<const char*>(header), headerBytes);
+		out.close();
+		
+	} catch (std::ios::failure &fail) {
+		throw Exception("IO error: " + std::string(fail.what()));
+	}
+}
+
+size_type GeometryBuilder::getVertexCount() const
+{
+	return countVertices;
+}
+
+size_type GeometryBuilder::getElementCount() const
+{
+	return countElements;
+}
+
+size_type GeometryBuilder::getUniqueCount() const
+{
+	return countUnique;
+}
+
+size_type GeometryBuilder::getRunCount() const
+{
+	return countRuns;
+}
+
+size_type GeometryBuilder::getMemoryBudget() const
+{
+	return memoryBudget;
+}
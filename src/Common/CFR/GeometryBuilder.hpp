@@ -0,0 +1,68 @@
+#pragma once
+#ifndef _CFR_GEOMETRYBUILDER_HPP_
+#define _CFR_GEOMETRYBUILDER_HPP_
+
+#include "Common.hpp"
+#include "Geometry.hpp"
+#include <string>
+#include <fstream>
+
+namespace CFR {
+	
+	
+	
+	/* Out-of-core CFR Geometry writer for meshes larger than memory.
+	 * Vertices and elements are spilled to temporary files next to the
+	 * output, finish() deduplicates the vertices with an external merge sort
+	 * and streams the file. The result is the same file Geometry writes for
+	 * the same addVertex() and addElement() calls. */
+	class GeometryBuilder {
+	public:
+		
+		/* Attribute types are taken from layout when finished, the memory
+		 * budget covers sort buffers, not the caller - throws CFR::Exception */
+		GeometryBuilder(const Geometry &layout, const std::string &file, size_type memoryBudget = 256 << 20);
+		~GeometryBuilder();
+		
+		/* Provisional index, duplicates are merged by finish() */
+		Uint32 addVertex(const Vertex &v);
+		
+		/* Add provisional index - throws CFR::Exception */
+		void addElement(Uint32 element);
+		
+		/* Sort, deduplicate and write the file, once - throws CFR::Exception */
+		void finish();
+		
+		/* Getters */
+		size_type getVertexCount()  const; // Vertices added
+		size_type getElementCount() const;
+		size_type getUniqueCount()  const; // Vertices written by finish()
+		size_type getRunCount()     const; // Sorted runs spilled by finish()
+		size_type getMemoryBudget() const;
+		
+	private:
+		
+		GeometryBuilder(const GeometryBuilder&) = delete;
+		GeometryBuilder& operator=(const GeometryBuilder&) = delete;
+		
+		const Geometry &layout;
+		std::string file;
+		size_type memoryBudget;
+		
+		/* Raw streams in insertion order */
+		std::ofstream vertices;
+		std::ofstream elements;
+		size_type countVertices = 0;
+		size_type countElements = 0;
+		
+		size_type countUnique = 0;
+		size_type countRuns   = 0;
+		bool finished = false;
+		
+	};
+	
+	
+	
+} // namespace CFR
+
+#endif // _CFR_GEOMETRYBUILDER_HPP_
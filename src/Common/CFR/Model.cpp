@@ -4,6 +4,7 @@
 
 using CFR::size_type;
 using CFR::ModelObject;
+using CFR::ModelLod;
 using CFR::Model;
 using CFR::Exception;
 
@@ -44,6 +45,21 @@ void Model::addObject(const ModelObject &obj)
 	objects.push_back(obj);
 }
 
+size_type Model::getObjectCount() const
+{
+	return objects.size();
+}
+
+const ModelObject& Model::getObject(size_type index) const
+{
+	return objects[index];
+}
+
+ModelObject& Model::getObject(size_type index)
+{
+	return objects[index];
+}
+
 void Model::saveToFile(const std::string &file) const
 {
 	try {
@@ -57,6 +73,14 @@ void Model::saveToFile(const std::string &file) const
 	}
 }
 
+void writeRange(std::ostream &out, const ModelObject &object) {
+	out << "range " << object.start << " " << object.end << "\n";
+	for (std::size_t i = 0; i < object.lods.size(); i++) {
+		const ModelLod &lod = object.lods[i];
+		out << "lod " << (i + 1) << " " << lod.start << " " << lod.end << " " << lod.error << "\n";
+	}
+}
+
 bool hasSameMaterial(const ModelObject &a, const ModelObject &b) {
 	if (a.diffuse_map.empty()) return false;
 	if (b.diffuse_map.empty()) return false;
@@ -83,12 +107,12 @@ std::ostream& operator<<(std::ostream& out, const Model& obj)
 		if (object.specular_map.empty())  out << "specular     " << object.specular.x << " " << object.specular.y << " " << object.specular.z << "\n";
 		if (object.emit_map.empty())      out << "emit         " << object.emit.x     << " " << object.emit.y     << " " << object.emit.z     << "\n";
 		if (object.specular_exp > 0.01f)  out << "specular_exp " << object.specular_exp << "\n";
-		out << "range " << object.start << " " << object.end << "\n";
+		writeRange(out, object);
 		for (std::size_t j = i + 1; j < copy.size(); j++) {
 			ModelObject& other = copy[j];
 			if (other.end <= other.start) continue;
 			if (hasSameMaterial(object, other)) {
-				out << "range " << other.start << " " << other.end << "\n";
+				writeRange(out, other);
 				other.start = 0; other.end = 0;
 			}
 		}
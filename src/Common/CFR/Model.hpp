@@ -13,6 +13,12 @@ namespace CFR {
 	
 	
 	
+	/* Simplified elements of a model object */
+	struct ModelLod {
+		size_type start, end;
+		float     error; // Model units
+	};
+	
 	/* Model object */
 	struct ModelObject {
 		ModelObject();
@@ -26,6 +32,7 @@ namespace CFR {
 		std::string mask_map;
 		Vec3        emit;
 		std::string emit_map;
+		std::vector<ModelLod> lods; // Coarser levels of [start, end)
 	};
 	
 	
@@ -39,6 +46,11 @@ namespace CFR {
 		void addObject (const ModelObject &obj);
 		void saveToFile(const std::string &file) const;
 		
+		/* Getters */
+		size_type getObjectCount() const;
+		const ModelObject& getObject(size_type index) const;
+		ModelObject& getObject(size_type index);
+		
 	private:
 		
 		const std::string geometry;
@@ -0,0 +1,666 @@
+#include "Optimize.hpp"
+#include <vector>
+#include <algorithm> // std::sort, std::unique, std::lower_bound
+#include <cmath> // std::pow, std::sqrt
+#include <cfloat> // FLT_MAX
+#include <glm/glm.hpp>
+
+using CFR::BaseGeometry;
+using CFR::CacheStats;
+using CFR::FetchStats;
+using CFR::size_type;
+using CFR::Uint8;
+using CFR::Uint32;
+using CFR::Uint64;
+using CFR::Vec3;
+using CFR::Vertex;
+using CFR::Meshlet;
+using CFR::Exception;
+
+/* Forsyth's scoring, tuned for an LRU cache of 32 vertices */
+static const size_type forsythCache     = 32;
+static const size_type forsythValence   = 32;
+static const float     forsythDecay     = 1.5f;
+static const float     forsythLast      = 0.75f;
+static const float     forsythBoost     = 2.f;
+static const float     forsythBoostPow  = 0.5f;
+static const Uint32    forsythNone      = 0xFFFFFFFF;
+static const Uint32    tableEmpty       = 0xFFFFFFFF;
+
+inline void inl_checkRange(const BaseGeometry &geometry, size_type start, size_type end, bool triangles = true) {
+	if (start > end || end > geometry.getElementCount()) {
+		throw Exception("Element range out of bounds.");
+	}
+	if (triangles && (end - start) % 3 != 0) {
+		throw Exception("Element range isn't made of triangles.");
+	}
+}
+
+/* Number vertices of the range from 0, in vertex order, returns vertex count.
+ * unique receives the vertex of each local number. */
+inline size_type inl_localize(const BaseGeometry &geometry, size_type start, size_type end,
+                              std::vector<Uint32> &local, std::vector<Uint32> &unique) {
+	local.resize(end - start);
+	for (size_type i = start; i < end; i++) local[i - start] = geometry.getElement(i);
+	unique = local;
+	std::sort(unique.begin(), unique.end());
+	unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+	for (size_type i = 0; i < local.size(); i++) {
+		local[i] = static_cast<Uint32>(std::lower_bound(unique.begin(), unique.end(), local[i]) - unique.begin());
+	}
+	return unique.size();
+}
+
+/* Score of a vertex by its LRU position (-1 if not cached) and remaining triangles */
+inline float inl_forsythScore(const float *cacheScore, const float *valenceScore, int position, Uint32 valence) {
+	if (valence == 0) return -1.f;
+	float score = position < 0 ? 0.f : cacheScore[position];
+	if (valence < forsythValence) return score + valenceScore[valence];
+	return score + forsythBoost * std::pow(static_cast<float>(valence), -forsythBoostPow);
+}
+
+inline glm::vec3 inl_glm(const Vec3 &v) {
+	return glm::vec3(v.x, v.y, v.z);
+}
+
+inline Vec3 inl_vec3(const glm::vec3 &v) {
+	Vec3 vec;
+	vec.x = v.x;
+	vec.y = v.y;
+	vec.z = v.z;
+	return vec;
+}
+
+/* Bounding sphere and normal cone of a meshlet's triangles */
+inline void inl_meshletBounds(const BaseGeometry &geometry, Meshlet &meshlet,
+                              const std::vector<Uint32> &vertices, const std::vector<Uint8> &triangles) {
+	
+	/* Sphere around the box */
+	glm::vec3 low(FLT_MAX), high(-FLT_MAX);
+	for (size_type i = 0; i < vertices.size(); i++) {
+		glm::vec3 p = inl_glm(geometry.getVertex(vertices[i]).position);
+		low  = glm::min(low,  p);
+		high = glm::max(high, p);
+	}
+	glm::vec3 center = (low + high) * 0.5f;
+	float radius = 0.f;
+	for (size_type i = 0; i < vertices.size(); i++) {
+		glm::vec3 p = inl_glm(geometry.getVertex(vertices[i]).position);
+		radius = std::max(radius, glm::length(p - center));
+	}
+	meshlet.center = inl_vec3(center);
+	meshlet.radius = radius;
+	
+	/* Face normals, degenerate triangles can't be seen and are left out */
+	std::vector<glm::vec3> normals, corners;
+	glm::vec3 sum(0.f);
+	for (size_type i = 0; i < triangles.size(); i += 3) {
+		glm::vec3 a = inl_glm(geometry.getVertex(vertices[triangles[i + 0]]).position);
+		glm::vec3 b = inl_glm(geometry.getVertex(vertices[triangles[i + 1]]).position);
+		glm::vec3 c = inl_glm(geometry.getVertex(vertices[triangles[i + 2]]).position);
+		glm::vec3 n = glm::cross(b - a, c - a);
+		float length = glm::length(n);
+		if (length <= 0.f) continue;
+		normals.push_back(n / length);
+		corners.push_back(a);
+		sum = sum + n / length;
+	}
+	
+	/* Cone around the average normal, wide cones are never worth testing */
+	meshlet.apex   = inl_vec3(center);
+	meshlet.axis   = inl_vec3(glm::vec3(0.f));
+	meshlet.cutoff = 1.f;
+	if (normals.empty() || glm::length(sum) <= 0.f) return;
+	glm::vec3 axis = glm::normalize(sum);
+	float spread = 1.f;
+	for (size_type i = 0; i < normals.size(); i++) spread = std::min(spread, glm::dot(axis, normals[i]));
+	if (spread <= 0.1f) return;
+	
+	/* Apex on the axis behind every triangle plane */
+	float offset = 0.f;
+	for (size_type i = 0; i < normals.size(); i++) {
+		float t = glm::dot(center - corners[i], normals[i]) / glm::dot(axis, normals[i]);
+		offset = std::max(offset, t);
+	}
+	meshlet.apex   = inl_vec3(center - axis * offset);
+	meshlet.axis   = inl_vec3(axis);
+	meshlet.cutoff = std::sqrt(1.f - spread * spread);
+}
+
+float CacheStats::getACMR() const
+{
+	return triangles > 0 ? static_cast<float>(misses) / triangles : 0.f;
+}
+
+float CacheStats::getATVR() const
+{
+	return vertices > 0 ? static_cast<float>(misses) / vertices : 0.f;
+}
+
+CacheStats& CacheStats::operator+=(const CacheStats &stats)
+{
+	triangles += stats.triangles;
+	vertices  += stats.vertices;
+	misses    += stats.misses;
+	return *this;
+}
+
+float FetchStats::getOverfetch() const
+{
+	return used > 0 ? static_cast<float>(fetched) / used : 0.f;
+}
+
+FetchStats& FetchStats::operator+=(const FetchStats &stats)
+{
+	vertices += stats.vertices;
+	misses   += stats.misses;
+	fetched  += stats.fetched;
+	used     += stats.used;
+	return *this;
+}
+
+CacheStats CFR::getCacheStats(const BaseGeometry &geometry, size_type start, size_type end, size_type cacheSize)
+{
+	inl_checkRange(geometry, start, end);
+	std::vector<Uint32> local, unique;
+	CacheStats stats;
+	stats.triangles = (end - start) / 3;
+	stats.vertices  = inl_localize(geometry, start, end, local, unique);
+	
+	/* A vertex is cached while fewer than cacheSize misses followed its own */
+	std::vector<size_type> stamp(stats.vertices, 0);
+	size_type time = cacheSize + 1;
+	for (size_type i = 0; i < local.size(); i++) {
+		if (time - stamp[local[i]] > cacheSize) {
+			stamp[local[i]] = time++;
+			stats.misses++;
+		}
+	}
+	return stats;
+}
+
+FetchStats CFR::getFetchStats(const BaseGeometry &geometry, size_type start, size_type end, size_type vertexSize,
+                              size_type cacheSize, size_type lineSize)
+{
+	inl_checkRange(geometry, start, end, false);
+	FetchStats stats;
+	if (vertexSize == 0 || lineSize == 0) return stats;
+	size_type lines = cacheSize / lineSize;
+	size_type total = (geometry.getVertexCount() * vertexSize + lineSize - 1) / lineSize;
+	
+	/* Same FIFO stamps as getCacheStats(), per line, and a visited mark per vertex */
+	std::vector<size_type> stamp(total, 0);
+	std::vector<bool> visited(geometry.getVertexCount(), false);
+	size_type time = lines + 1;
+	for (size_type i = start; i < end; i++) {
+		Uint32 v = geometry.getElement(i);
+		if (!visited[v]) {
+			visited[v] = true;
+			stats.vertices++;
+		}
+		size_type first = v * vertexSize / lineSize;
+		size_type last  = (v * vertexSize + vertexSize - 1) / lineSize;
+		for (size_type line = first; line <= last; line++) {
+			if (time - stamp[line] > lines) {
+				stamp[line] = time++;
+				stats.misses++;
+			}
+		}
+	}
+	stats.fetched = stats.misses * lineSize;
+	stats.used    = stats.vertices * vertexSize;
+	return stats;
+}
+
+void CFR::optimizeVertexCache(BaseGeometry &geometry, size_type start, size_type end)
+{
+	inl_checkRange(geometry, start, end);
+	std::vector<Uint32> local, unique;
+	size_type vertexCount   = inl_localize(geometry, start, end, local, unique);
+	size_type triangleCount = local.size() / 3;
+	if (triangleCount < 2) return;
+	
+	/* Score tables */
+	float cacheScore[forsythCache];
+	float valenceScore[forsythValence];
+	for (size_type i = 0; i < forsythCache; i++) {
+		if (i < 3) {
+			cacheScore[i] = forsythLast;
+		} else {
+			float scale = 1.f / (forsythCache - 3);
+			cacheScore[i] = std::pow(1.f - (i - 3) * scale, forsythDecay);
+		}
+	}
+	valenceScore[0] = 0.f;
+	for (size_type i = 1; i < forsythValence; i++) {
+		valenceScore[i] = forsythBoost * std::pow(static_cast<float>(i), -forsythBoostPow);
+	}
+	
+	/* Triangles of each vertex, the first valence[v] are not emitted yet */
+	std::vector<Uint32> valence(vertexCount, 0);
+	std::vector<Uint32> offset(vertexCount + 1, 0);
+	std::vector<Uint32> adjacent(local.size());
+	for (size_type i = 0; i < local.size(); i++) valence[local[i]]++;
+	for (size_type v = 0; v < vertexCount; v++) offset[v + 1] = offset[v] + valence[v];
+	std::fill(valence.begin(), valence.end(), 0);
+	for (size_type i = 0; i < local.size(); i++) {
+		Uint32 v = local[i];
+		adjacent[offset[v] + valence[v]++] = static_cast<Uint32>(i / 3);
+	}
+	
+	/* Initial scores */
+	std::vector<float> vertexScore(vertexCount);
+	std::vector<bool>  emitted(triangleCount, false);
+	for (size_type v = 0; v < vertexCount; v++) {
+		vertexScore[v] = inl_forsythScore(cacheScore, valenceScore, -1, valence[v]);
+	}
+	Uint32 best = 0;
+	float bestScore = -1.f;
+	for (size_type t = 0; t < triangleCount; t++) {
+		const Uint32 *tri = &local[t * 3];
+		float score = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+		if (score > bestScore) {
+			bestScore = score;
+			best = static_cast<Uint32>(t);
+		}
+	}
+	
+	/* LRU cache with room for the 3 vertices pushed by each triangle */
+	Uint32 cache[forsythCache + 3];
+	Uint32 cacheNext[forsythCache + 3];
+	size_type cacheUsed = 0;
+	
+	std::vector<Uint32> order;
+	order.reserve(triangleCount);
+	size_type cursor = 0;
+	while (order.size() < triangleCount) {
+		
+		/* Nothing cached left to draw, continue in input order */
+		if (best == forsythNone) {
+			while (emitted[cursor]) cursor++;
+			best = static_cast<Uint32>(cursor);
+		}
+		
+		/* Emit */
+		const Uint32 *tri = &local[best * 3];
+		order.push_back(best);
+		emitted[best] = true;
+		for (int k = 0; k < 3; k++) {
+			Uint32 v = tri[k];
+			Uint32 *list = &adjacent[offset[v]];
+			for (Uint32 j = 0; j < valence[v]; j++) {
+				if (list[j] == best) {
+					list[j] = list[valence[v] - 1];
+					list[valence[v] - 1] = best;
+					break;
+				}
+			}
+			valence[v]--;
+		}
+		
+		/* Move the triangle's vertices to the front */
+		size_type used = 0;
+		for (int k = 0; k < 3; k++) {
+			if (k > 0 && tri[k] == tri[0]) continue;
+			if (k > 1 && tri[k] == tri[1]) continue;
+			cacheNext[used++] = tri[k];
+		}
+		for (size_type i = 0; i < cacheUsed; i++) {
+			Uint32 v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2]) cacheNext[used++] = v;
+		}
+		
+		/* Rescore vertices that moved or fell out, then their triangles */
+		for (size_type i = 0; i < used; i++) {
+			Uint32 v = cacheNext[i];
+			int position = i < forsythCache ? static_cast<int>(i) : -1;
+			vertexScore[v] = inl_forsythScore(cacheScore, valenceScore, position, valence[v]);
+		}
+		best = forsythNone;
+		bestScore = -1.f;
+		for (size_type i = 0; i < used; i++) {
+			Uint32 v = cacheNext[i];
+			const Uint32 *list = &adjacent[offset[v]];
+			for (Uint32 j = 0; j < valence[v]; j++) {
+				const Uint32 *other = &local[list[j] * 3];
+				float score = vertexScore[other[0]] + vertexScore[other[1]] + vertexScore[other[2]];
+				if (score > bestScore) {
+					bestScore = score;
+					best = list[j];
+				}
+			}
+		}
+		
+		cacheUsed = used < forsythCache ? used : forsythCache;
+		std::copy(cacheNext, cacheNext + cacheUsed, cache);
+		
+	}
+	
+	/* Write back in the new order */
+	std::vector<Uint32> elements(local.size());
+	for (size_type i = 0; i < local.size(); i++) elements[i] = geometry.getElement(start + i);
+	for (size_type i = 0; i < triangleCount; i++) {
+		for (size_type k = 0; k < 3; k++) {
+			geometry.setElement(start + i * 3 + k, elements[order[i] * 3 + k]);
+		}
+	}
+}
+
+size_type CFR::buildMeshlets(BaseGeometry &geometry, size_type start, size_type end,
+                             size_type maxVertices, size_type maxTriangles)
+{
+	inl_checkRange(geometry, start, end);
+	if (maxVertices < 3 || maxVertices > 256 || maxTriangles < 1) {
+		throw Exception("Invalid meshlet limits.");
+	}
+	std::vector<Uint32> vertices;
+	std::vector<Uint8>  triangles;
+	vertices.reserve(maxVertices);
+	triangles.reserve(maxTriangles * 3);
+	Meshlet meshlet;
+	meshlet.elementOffset = static_cast<Uint32>(start);
+	size_type count = 0;
+	for (size_type i = start; i <= end; i += 3) {
+		
+		/* Vertices the triangle would add */
+		size_type added = 0;
+		Uint32 corner[3];
+		for (size_type k = 0; i < end && k < 3; k++) {
+			corner[k] = geometry.getElement(i + k);
+			bool found = std::find(vertices.begin(), vertices.end(), corner[k]) != vertices.end();
+			for (size_type j = 0; j < k; j++) found = found || corner[j] == corner[k];
+			if (!found) added++;
+		}
+		
+		/* Close the meshlet when full or at the end */
+		bool full = vertices.size() + added > maxVertices || triangles.size() / 3 >= maxTriangles;
+		if (!triangles.empty() && (full || i == end)) {
+			meshlet.vertexCount   = static_cast<Uint32>(vertices.size());
+			meshlet.triangleCount = static_cast<Uint32>(triangles.size() / 3);
+			inl_meshletBounds(geometry, meshlet, vertices, triangles);
+			geometry.addMeshlet(meshlet, vertices.data(), triangles.data());
+			meshlet.elementOffset = static_cast<Uint32>(i);
+			vertices.clear();
+			triangles.clear();
+			count++;
+		}
+		if (i == end) break;
+		
+		/* Add triangle */
+		for (size_type k = 0; k < 3; k++) {
+			size_type local = std::find(vertices.begin(), vertices.end(), corner[k]) - vertices.begin();
+			if (local == vertices.size()) vertices.push_back(corner[k]);
+			triangles.push_back(static_cast<Uint8>(local));
+		}
+		
+	}
+	return count;
+}
+
+bool CFR::isMeshletBackfacing(const Meshlet &meshlet, const Vec3 &camera)
+{
+	if (meshlet.cutoff >= 1.f) return false;
+	glm::vec3 view = inl_glm(meshlet.apex) - inl_glm(camera);
+	return glm::dot(view, inl_glm(meshlet.axis)) >= meshlet.cutoff * glm::length(view);
+}
+
+/* Simplification */
+
+enum SimplifyKind {
+	KIND_MANIFOLD, // Free to move
+	KIND_SEAM,     // Two wedges, moves along the seam only
+	KIND_LOCKED    // Border, non-manifold or more than two wedges
+};
+
+/* Area weighted sum of squared plane distances */
+struct Quadric {
+	double a2 = 0, b2 = 0, c2 = 0, ab = 0, ac = 0, bc = 0, ad = 0, bd = 0, cd = 0, d2 = 0, w = 0;
+};
+
+inline void inl_quadricAdd(Quadric &q, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c) {
+	glm::vec3 n = glm::cross(b - a, c - a);
+	float length = glm::length(n);
+	if (length <= 0.f) return;
+	n = n / length;
+	double d = -glm::dot(n, a);
+	double w = length * 0.5;
+	q.a2 += w * n.x * n.x; q.b2 += w * n.y * n.y; q.c2 += w * n.z * n.z;
+	q.ab += w * n.x * n.y; q.ac += w * n.x * n.z; q.bc += w * n.y * n.z;
+	q.ad += w * n.x * d;   q.bd += w * n.y * d;   q.cd += w * n.z * d;
+	q.d2 += w * d * d;
+	q.w  += w;
+}
+
+inline void inl_quadricAdd(Quadric &q, const Quadric &o) {
+	q.a2 += o.a2; q.b2 += o.b2; q.c2 += o.c2;
+	q.ab += o.ab; q.ac += o.ac; q.bc += o.bc;
+	q.ad += o.ad; q.bd += o.bd; q.cd += o.cd;
+	q.d2 += o.d2;
+	q.w  += o.w;
+}
+
+/* Mean squared distance of p to the planes */
+inline double inl_quadricError(const Quadric &q, const glm::vec3 &p) {
+	double x = p.x, y = p.y, z = p.z;
+	double e = q.a2 * x * x + q.b2 * y * y + q.c2 * z * z
+	         + 2 * (q.ab * x * y + q.ac * x * z + q.bc * y * z)
+	         + 2 * (q.ad * x + q.bd * y + q.cd * z) + q.d2;
+	return q.w > 0 ? std::max(e, 0.0) / q.w : 0.0;
+}
+
+inline Uint64 inl_edge(Uint32 a, Uint32 b) {
+	return (static_cast<Uint64>(a) << 32) | b;
+}
+
+inline bool inl_hasEdge(const std::vector<Uint64> &edges, Uint32 a, Uint32 b) {
+	return std::binary_search(edges.begin(), edges.end(), inl_edge(a, b));
+}
+
+/* Whether moving wedge from onto to turns over a triangle that keeps its area,
+ * the other corners are where the collapses so far in the pass moved them */
+inline bool inl_flips(const std::vector<Uint32> &indices, const std::vector<Uint32> &adjacentOffset,
+                      const std::vector<Uint32> &adjacent, const std::vector<Uint32> &position,
+                      const std::vector<glm::vec3> &points, const std::vector<Uint32> &remap,
+                      Uint32 from, Uint32 to) {
+	for (Uint32 i = adjacentOffset[from]; i < adjacentOffset[from + 1]; i++) {
+		const Uint32 *tri = &indices[adjacent[i] * 3];
+		int k = tri[0] == from ? 0 : tri[1] == from ? 1 : 2;
+		Uint32 b = remap[tri[(k + 1) % 3]];
+		Uint32 c = remap[tri[(k + 2) % 3]];
+		if (position[b] == position[to] || position[c] == position[to] || position[b] == position[c]) continue;
+		glm::vec3 before = glm::cross(points[b] - points[from], points[c] - points[from]);
+		glm::vec3 after  = glm::cross(points[b] - points[to],   points[c] - points[to]);
+		if (glm::dot(before, after) <= 0.f) return true;
+	}
+	return false;
+}
+
+float CFR::simplify(const BaseGeometry &geometry, size_type start, size_type end,
+                    size_type targetTriangles, std::vector<Uint32> &result, float maxError)
+{
+	inl_checkRange(geometry, start, end);
+	std::vector<Uint32> corners, unique;
+	size_type vertices = inl_localize(geometry, start, end, corners, unique);
+	
+	/* Wedges are vertices up to the tangent, which follows each triangle */
+	static const size_type keySize = 8;
+	std::vector<float> keys(vertices * keySize);
+	for (size_type v = 0; v < vertices; v++) {
+		const Vertex &vertex = geometry.getVertex(unique[v]);
+		float key[keySize] = {
+			vertex.position.x, vertex.position.y, vertex.position.z,
+			vertex.texcoord.x, vertex.texcoord.y,
+			vertex.normal.x,   vertex.normal.y,   vertex.normal.z
+		};
+		std::copy(key, key + keySize, &keys[v * keySize]);
+	}
+	std::vector<Uint32> order(vertices);
+	for (size_type v = 0; v < vertices; v++) order[v] = static_cast<Uint32>(v);
+	std::sort(order.begin(), order.end(), [&](Uint32 a, Uint32 b) {
+		return std::lexicographical_compare(&keys[a * keySize], &keys[a * keySize + keySize], &keys[b * keySize], &keys[b * keySize + keySize]);
+	});
+	
+	/* Wedge numbers follow the sort, so wedges of a position are consecutive */
+	std::vector<Uint32> wedge(vertices);
+	std::vector<Uint32> source;      // First vertex of each wedge
+	std::vector<Uint32> wedgeOffset; // First wedge of each position
+	for (size_type i = 0; i < vertices; i++) {
+		const float *key  = &keys[order[i] * keySize];
+		const float *last = i > 0 ? &keys[order[i - 1] * keySize] : nullptr;
+		if (!last || !std::equal(key, key + 3, last)) wedgeOffset.push_back(static_cast<Uint32>(source.size()));
+		if (!last || !std::equal(key, key + keySize, last)) source.push_back(order[i]);
+		wedge[order[i]] = static_cast<Uint32>(source.size() - 1);
+	}
+	size_type count     = source.size();
+	size_type positions = wedgeOffset.size();
+	wedgeOffset.push_back(static_cast<Uint32>(count));
+	std::vector<glm::vec3> points(count);
+	std::vector<Uint32>    position(count);
+	for (size_type p = 0; p < positions; p++) {
+		for (Uint32 w = wedgeOffset[p]; w < wedgeOffset[p + 1]; w++) {
+			points[w]   = inl_glm(geometry.getVertex(unique[source[w]]).position);
+			position[w] = static_cast<Uint32>(p);
+		}
+	}
+	std::vector<Uint32> indices(corners.size());
+	for (size_type i = 0; i < corners.size(); i++) indices[i] = wedge[corners[i]];
+	
+	/* Classify positions, open or shared edges lock both ends */
+	std::vector<Uint8> kind(positions);
+	for (size_type p = 0; p < positions; p++) {
+		Uint32 n = wedgeOffset[p + 1] - wedgeOffset[p];
+		kind[p] = n == 1 ? KIND_MANIFOLD : n == 2 ? KIND_SEAM : KIND_LOCKED;
+	}
+	std::vector<Uint64> edges;
+	edges.reserve(indices.size());
+	for (size_type i = 0; i < indices.size(); i++) {
+		Uint32 a = position[indices[i]];
+		Uint32 b = position[indices[i - i % 3 + (i + 1) % 3]];
+		if (a != b) edges.push_back(inl_edge(a, b));
+	}
+	std::sort(edges.begin(), edges.end());
+	for (size_type i = 0; i < edges.size(); i++) {
+		Uint32 a = static_cast<Uint32>(edges[i] >> 32);
+		Uint32 b = static_cast<Uint32>(edges[i]);
+		bool shared = (i > 0 && edges[i - 1] == edges[i]) || (i + 1 < edges.size() && edges[i + 1] == edges[i]);
+		if (shared || !inl_hasEdge(edges, b, a)) kind[a] = kind[b] = KIND_LOCKED;
+	}
+	
+	/* Quadrics of the original planes */
+	std::vector<Quadric> quadrics(positions);
+	for (size_type i = 0; i < indices.size(); i += 3) {
+		const glm::vec3 &a = points[indices[i + 0]];
+		const glm::vec3 &b = points[indices[i + 1]];
+		const glm::vec3 &c = points[indices[i + 2]];
+		for (size_type k = 0; k < 3; k++) inl_quadricAdd(quadrics[position[indices[i + k]]], a, b, c);
+	}
+	
+	struct Collapse {
+		Uint32 from, to;
+		double cost;
+	};
+	double errorLimit = static_cast<double>(maxError) * maxError;
+	double errorMax   = 0;
+	std::vector<Uint32> remap(count);
+	std::vector<bool>   touched(positions);
+	std::vector<Uint32> adjacentOffset(count + 1);
+	std::vector<Uint32> adjacent;
+	std::vector<Collapse> collapses;
+	while (indices.size() / 3 > targetTriangles) {
+		
+		/* Current wedge edges and triangles around each wedge */
+		edges.clear();
+		std::fill(adjacentOffset.begin(), adjacentOffset.end(), 0);
+		for (size_type i = 0; i < indices.size(); i++) {
+			edges.push_back(inl_edge(indices[i], indices[i - i % 3 + (i + 1) % 3]));
+			adjacentOffset[indices[i] + 1]++;
+		}
+		std::sort(edges.begin(), edges.end());
+		for (size_type v = 0; v < count; v++) adjacentOffset[v + 1] += adjacentOffset[v];
+		adjacent.resize(indices.size());
+		std::vector<Uint32> fill(adjacentOffset.begin(), adjacentOffset.end() - 1);
+		for (size_type i = 0; i < indices.size(); i++) adjacent[fill[indices[i]]++] = static_cast<Uint32>(i / 3);
+		
+		/* Cheaper direction of every edge */
+		collapses.clear();
+		for (size_type i = 0; i < edges.size(); i++) {
+			Uint32 a = static_cast<Uint32>(edges[i] >> 32);
+			Uint32 b = static_cast<Uint32>(edges[i]);
+			if (position[a] == position[b]) continue;
+			Collapse c;
+			c.cost = -1;
+			if (kind[position[a]] != KIND_LOCKED) {
+				c.from = a;
+				c.to   = b;
+				c.cost = inl_quadricError(quadrics[position[a]], points[b]);
+			}
+			if (kind[position[b]] != KIND_LOCKED) {
+				double cost = inl_quadricError(quadrics[position[b]], points[a]);
+				if (c.cost < 0 || cost < c.cost) {
+					c.from = b;
+					c.to   = a;
+					c.cost = cost;
+				}
+			}
+			if (c.cost >= 0 && c.cost <= errorLimit) collapses.push_back(c);
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+			return a.cost < b.cost;
+		});
+		
+		/* Cheapest first, each position once per pass, about 2 triangles each */
+		for (size_type v = 0; v < count; v++) remap[v] = static_cast<Uint32>(v);
+		std::fill(touched.begin(), touched.end(), false);
+		size_type goal = indices.size() / 3 - targetTriangles;
+		size_type removed = 0;
+		for (size_type i = 0; i < collapses.size() && removed < goal; i++) {
+			const Collapse &c = collapses[i];
+			Uint32 pv = position[c.from];
+			Uint32 pu = position[c.to];
+			if (touched[pv] || touched[pu]) continue;
+			if (inl_flips(indices, adjacentOffset, adjacent, position, points, remap, c.from, c.to)) continue;
+			
+			/* The other wedge of a seam follows along the other side */
+			if (kind[pv] == KIND_SEAM) {
+				Uint32 from = wedgeOffset[pv] == c.from ? wedgeOffset[pv] + 1 : wedgeOffset[pv];
+				Uint32 to = tableEmpty;
+				for (Uint32 w = wedgeOffset[pu]; w < wedgeOffset[pu + 1]; w++) {
+					if (w == c.to) continue;
+					if (inl_hasEdge(edges, from, w) || inl_hasEdge(edges, w, from)) to = w;
+				}
+				if (to == tableEmpty) continue;
+				if (inl_flips(indices, adjacentOffset, adjacent, position, points, remap, from, to)) continue;
+				remap[from] = to;
+			}
+			remap[c.from] = c.to;
+			inl_quadricAdd(quadrics[pu], quadrics[pv]);
+			touched[pv] = touched[pu] = true;
+			errorMax = std::max(errorMax, c.cost);
+			removed += 2;
+		}
+		if (removed == 0) break;
+		
+		/* Drop triangles that lost their area */
+		size_type write = 0;
+		for (size_type i = 0; i < indices.size(); i += 3) {
+			Uint32 a = remap[indices[i + 0]];
+			Uint32 b = remap[indices[i + 1]];
+			Uint32 c = remap[indices[i + 2]];
+			if (position[a] == position[b] || position[b] == position[c] || position[c] == position[a]) continue;
+			for (size_type k = 0; k < 3; k++) corners[write + k] = corners[i + k];
+			indices[write++] = a;
+			indices[write++] = b;
+			indices[write++] = c;
+		}
+		indices.resize(write);
+		corners.resize(write);
+		
+	}
+	
+	/* Corners that kept their wedge keep their vertex and tangent */
+	result.resize(indices.size());
+	for (size_type i = 0; i < indices.size(); i++) {
+		result[i] = unique[indices[i] == wedge[corners[i]] ? corners[i] : source[indices[i]]];
+	}
+	return static_cast<float>(std::sqrt(errorMax));
+}
@@ -0,0 +1,74 @@
+#pragma once
+#ifndef _CFR_OPTIMIZE_HPP_
+#define _CFR_OPTIMIZE_HPP_
+
+#include "Common.hpp"
+#include "BaseGeometry.hpp"
+#include <vector>
+#include <cfloat> // FLT_MAX
+
+namespace CFR {
+	
+	
+	
+	/* Post-transform vertex cache statistics */
+	struct CacheStats {
+		size_type triangles = 0;
+		size_type vertices  = 0; // Unique vertices used
+		size_type misses    = 0; // Vertex shader invocations
+		float getACMR() const;   // Misses per triangle, 0.5 at best for large grids
+		float getATVR() const;   // Misses per used vertex, 1 at best
+		CacheStats& operator+=(const CacheStats &stats);
+	};
+	
+	/* Vertex fetch statistics */
+	struct FetchStats {
+		size_type vertices = 0; // Unique vertices used
+		size_type misses   = 0; // Cache lines read
+		size_type fetched  = 0; // Bytes read
+		size_type used     = 0; // Bytes of the unique vertices
+		float getOverfetch() const; // Bytes read per byte used, about 1 at best
+		FetchStats& operator+=(const FetchStats &stats);
+	};
+	
+	/* Simulate a FIFO cache over the triangles of elements [start, end)
+	 * Throws CFR::Exception if the range isn't made of triangles */
+	CacheStats getCacheStats(const BaseGeometry &geometry, size_type start, size_type end, size_type cacheSize = 16);
+	
+	/* Simulate a FIFO cache of lineSize byte lines over the vertex reads of
+	 * elements [start, end), with vertexSize bytes per vertex.
+	 * Throws CFR::Exception if the range is out of bounds */
+	FetchStats getFetchStats(const BaseGeometry &geometry, size_type start, size_type end, size_type vertexSize,
+	                         size_type cacheSize = 16384, size_type lineSize = 64);
+	
+	/* Reorder the triangles of elements [start, end) for the post-transform
+	 * vertex cache with Forsyth's linear-speed algorithm. Triangles keep their
+	 * winding and don't leave the range, vertices aren't touched.
+	 * Throws CFR::Exception if the range isn't made of triangles */
+	void optimizeVertexCache(BaseGeometry &geometry, size_type start, size_type end);
+	
+	/* Split the triangles of elements [start, end) into meshlets of at most
+	 * maxVertices (up to 256) vertices and maxTriangles triangles, in element
+	 * order, with bounding spheres and normal cones. Returns meshlets added.
+	 * Throws CFR::Exception */
+	size_type buildMeshlets(BaseGeometry &geometry, size_type start, size_type end,
+	                        size_type maxVertices = 64, size_type maxTriangles = 124);
+	
+	/* Quadric error edge collapse of the triangles in elements [start, end)
+	 * until at most targetTriangles remain or a collapse would cost more than
+	 * maxError, in model units. Vertices aren't moved or added, so the result
+	 * can be appended to the elements as a LOD sharing the vertices. Range
+	 * borders, non-manifold spots and vertices with more than two attribute
+	 * sets stay, two sided UV and normal seams only shorten along themselves.
+	 * Returns the error reached. Throws CFR::Exception */
+	float simplify(const BaseGeometry &geometry, size_type start, size_type end,
+	               size_type targetTriangles, std::vector<Uint32> &result, float maxError = FLT_MAX);
+	
+	/* Normal cone test, true if no triangle of the meshlet faces the camera */
+	bool isMeshletBackfacing(const Meshlet &meshlet, const Vec3 &camera);
+	
+	
+	
+} // namespace CFR
+
+#endif // _CFR_OPTIMIZE_HPP_
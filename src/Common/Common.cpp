@@ -1,7 +1,16 @@
 #include "Common.hpp"
+#include "ByteScan.hpp"
 #include <vector>
 #include <fstream>
-#include <algorithm> // std::count
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define PSAPI_VERSION 2
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
 
 std::string getSuffix(const std::string &str, char c) {
 	std::string::size_type n = str.rfind(c);
@@ -46,7 +55,7 @@ std::size_t countFileLines(const std::string &file)
 	std::size_t lines = 0;
 	while (size > 0) {
 		stream.read(data.data(), alloc);
-		lines += std::count(data.begin(), data.begin() + alloc, '\n');
+		lines += countByte(data.data(), data.data() + alloc, '\n');
 		size -= alloc;
 		if (size < alloc) alloc = size;
 	}
@@ -63,3 +72,19 @@ const char* getChannelName(CFR::size_type channels) {
 	default: return "INVALID";
 	}
 }
+
+std::size_t getPeakMemory() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+	return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+	return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
@@ -4,7 +4,10 @@
 
 #include "CFR/Texture.hpp"
 #include "CFR/Geometry.hpp"
+#include "CFR/GeometryBuilder.hpp"
 #include "CFR/Model.hpp"
+#include "CFR/Optimize.hpp"
+#include "CFR/Codec.hpp"
 #include "OBJ/ElementReader.hpp"
 #include "OBJ/MaterialReader.hpp"
 #include <string>
@@ -16,6 +19,7 @@ std::string getPrefix     (const std::string &str, char c);
 std::string removePath    (const std::string &path);
 std::size_t countFileLines(const std::string &file);
 const char* getChannelName(CFR::size_type channels);
+std::size_t getPeakMemory(); // Peak resident set size in bytes, 0 if unknown
 
 template <typename T>
 const std::string to_string(const T &value)
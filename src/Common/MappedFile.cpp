@@ -0,0 +1,108 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+: address(nullptr), length(0), opened(false)
+{}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &file)
+{
+	close();
+	HANDLE handle = CreateFileA(
+		file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr
+	);
+	if (handle == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(handle, &size)) {
+		CloseHandle(handle);
+		return false;
+	}
+	if (size.QuadPart == 0) {
+		CloseHandle(handle);
+		return opened = true;
+	}
+	HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(handle);
+	if (mapping == nullptr) return false;
+	void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (view == nullptr) return false;
+	address = static_cast<const char*>(view);
+	length  = static_cast<std::size_t>(size.QuadPart);
+	return opened = true;
+}
+
+void MappedFile::close()
+{
+	if (address) UnmapViewOfFile(address);
+	address = nullptr;
+	length  = 0;
+	opened  = false;
+}
+
+#else
+
+bool MappedFile::open(const std::string &file)
+{
+	close();
+	int fd = ::open(file.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat info;
+	if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+		::close(fd);
+		return false;
+	}
+	if (info.st_size == 0) {
+		::close(fd);
+		return opened = true;
+	}
+	void *view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (view == MAP_FAILED) return false;
+	madvise(view, info.st_size, MADV_SEQUENTIAL);
+	address = static_cast<const char*>(view);
+	length  = static_cast<std::size_t>(info.st_size);
+	return opened = true;
+}
+
+void MappedFile::close()
+{
+	if (address) munmap(const_cast<char*>(address), length);
+	address = nullptr;
+	length  = 0;
+	opened  = false;
+}
+
+#endif
+
+bool MappedFile::isOpen() const
+{
+	return opened;
+}
+
+const char* MappedFile::data() const
+{
+	return address;
+}
+
+std::size_t MappedFile::size() const
+{
+	return length;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#ifndef _MAPPEDFILE_HPP_
+#define _MAPPEDFILE_HPP_
+
+#include <string>
+#include <cstddef> // std::size_t
+
+/* Read-only memory mapping of a whole file */
+class MappedFile {
+public:
+	
+	MappedFile();
+	~MappedFile();
+	
+	/* Map file, returns false if it can't be opened or mapped */
+	bool open(const std::string &file);
+	void close();
+	
+	/* Getters - data() is nullptr for empty files */
+	bool isOpen() const;
+	const char* data() const;
+	std::size_t size() const;
+	
+private:
+	
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	
+	const char *address;
+	std::size_t length;
+	bool opened;
+	
+};
+
+#endif // _MAPPEDFILE_HPP_
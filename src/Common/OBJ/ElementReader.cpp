@@ -2,6 +2,27 @@
 #include <cstddef> // std::size_t
 
 using OBJ::ElementReader;
+using OBJ::TriangleBatch;
+
+void ElementReader::setTriangleBatch(TriangleBatch mode, std::size_t size)
+{
+	ElementReader::flush();
+	batch     = mode;
+	batchSize = size > 0 ? size : 1;
+	triangleBatch.reserve(mode == BATCH_TRIANGLES ? batchSize : 0);
+	indexBatch.reserve(mode == BATCH_INDICES ? batchSize : 0);
+	batchLines.reserve(mode == BATCH_NONE ? 0 : batchSize);
+}
+
+TriangleBatch ElementReader::getTriangleBatch() const
+{
+	return batch;
+}
+
+std::size_t ElementReader::getTriangleBatchSize() const
+{
+	return batchSize;
+}
 
 bool ElementReader::parse(OBJ::Vertex::Geometry &v)
 {
@@ -36,7 +57,122 @@ bool ElementReader::parse(Point&)
 	return false;
 }
 
-bool ElementReader::convert(OBJ::Element::FaceVertex &f, OBJ::TriangleVertex &e)
+void ElementReader::triangles(OBJ::Triangle *t, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; i++) {
+		if (!parse(t[i])) rejectTriangle(i);
+	}
+}
+
+void ElementReader::triangles(const OBJ::TriangleIndex *t, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; i++) {
+		OBJ::Triangle e;
+		resolve(t[i].a, e.a);
+		resolve(t[i].b, e.b);
+		resolve(t[i].c, e.c);
+		if (!parse(e)) rejectTriangle(i);
+	}
+}
+
+void ElementReader::rejectTriangle(std::size_t index)
+{
+	batchRejected.push_back(index);
+}
+
+const std::vector<OBJ::Vertex::Geometry>& ElementReader::getGeometry() const
+{
+	return geometry;
+}
+
+const std::vector<OBJ::Vertex::Texture>& ElementReader::getTexture() const
+{
+	return texture;
+}
+
+const std::vector<OBJ::Vertex::Normal>& ElementReader::getNormal() const
+{
+	return normal;
+}
+
+void ElementReader::resolve(const OBJ::VertexIndex &i, OBJ::TriangleVertex &e) const
+{
+	e.hasTexture = i.hasTexture;
+	e.hasNormal  = i.hasNormal;
+	e.position.x = geometry[i.position].x;
+	e.position.y = geometry[i.position].y;
+	e.position.z = geometry[i.position].z;
+	e.position.w = geometry[i.position].w;
+	
+	if (i.hasTexture) {
+		e.texture.x = texture[i.texture].u;
+		e.texture.y = texture[i.texture].v;
+		e.texture.z = texture[i.texture].w;
+	}
+	
+	if (i.hasNormal) {
+		e.normal.x = normal[i.normal].i;
+		e.normal.y = normal[i.normal].j;
+		e.normal.z = normal[i.normal].k;
+	}
+}
+
+void ElementReader::flush()
+{
+	deliver();
+	reported = 0;
+}
+
+void ElementReader::invalid(const OBJ::Range &line)
+{
+	if (pending.empty()) {
+		if (getLineNumber() != reported) logInvalid(getLineNumber(), line);
+		return;
+	}
+	pend(line);
+	pending.back().invalid = true;
+}
+
+void ElementReader::pend(const OBJ::Range &line)
+{
+	std::size_t number = getLineNumber();
+	if (!pending.empty() && pending.back().number == number) return;
+	
+	/* A line logged by a batch delivered within it is not logged again */
+	PendingLine p = { number, pendingText.size(), line.size(), false, number == reported };
+	pendingText.append(line.begin, line.size());
+	pending.push_back(p);
+}
+
+void ElementReader::deliver()
+{
+	if (!triangleBatch.empty()) {
+		triangles(triangleBatch.data(), triangleBatch.size());
+		triangleBatch.clear();
+	}
+	if (!indexBatch.empty()) {
+		triangles(indexBatch.data(), indexBatch.size());
+		indexBatch.clear();
+	}
+	
+	/* Each line is logged once, in order with the invalid lines held back */
+	for (std::size_t i = 0; i < batchRejected.size(); i++) {
+		pending[batchLines[batchRejected[i]]].invalid = true;
+	}
+	for (std::size_t i = 0; i < pending.size(); i++) {
+		const PendingLine &p = pending[i];
+		if (!p.invalid || p.logged) continue;
+		const char *text = pendingText.data() + p.offset;
+		logInvalid(p.number, Range(text, text + p.size));
+		reported = p.number;
+	}
+	batchRejected.clear();
+	batchLines.clear();
+	pending.clear();
+	pendingText.clear();
+}
+
+bool ElementReader::convert(OBJ::Element::FaceVertex &f, OBJ::VertexIndex &e)
 {
 	if (f.v < 0) f.v = 1 + geometry.size() + f.v;
 	if (static_cast<std::size_t>(f.v) > geometry.size() || f.v == 0) {
@@ -45,19 +181,14 @@ bool ElementReader::convert(OBJ::Element::FaceVertex &f, OBJ::TriangleVertex &e)
 	
 	e.hasTexture = f.hasTexture;
 	e.hasNormal  = f.hasNormal;
-	e.position.x = geometry[f.v - 1].x;
-	e.position.y = geometry[f.v - 1].y;
-	e.position.z = geometry[f.v - 1].z;
-	e.position.w = geometry[f.v - 1].w;
+	e.position   = f.v - 1;
 	
 	if (f.hasTexture) {
 		if (f.vt < 0) f.vt = 1 + texture.size() + f.vt;
 		if (static_cast<std::size_t>(f.vt) > texture.size() || f.vt == 0) {
 			return false;
 		}
-		e.texture.x = texture[f.vt - 1].u;
-		e.texture.y = texture[f.vt - 1].v;
-		e.texture.z = texture[f.vt - 1].w;
+		e.texture = f.vt - 1;
 	}
 	
 	if (f.hasNormal) {
@@ -65,14 +196,20 @@ bool ElementReader::convert(OBJ::Element::FaceVertex &f, OBJ::TriangleVertex &e)
 		if (static_cast<std::size_t>(f.vn) > normal.size() || f.vn == 0) {
 			return false;
 		}
-		e.normal.x = normal[f.vn - 1].i;
-		e.normal.y = normal[f.vn - 1].j;
-		e.normal.z = normal[f.vn - 1].k;
+		e.normal = f.vn - 1;
 	}
 	
 	return true;
 }
 
+bool ElementReader::convert(OBJ::Element::FaceVertex &f, OBJ::TriangleVertex &e)
+{
+	OBJ::VertexIndex i;
+	if (!convert(f, i)) return false;
+	resolve(i, e);
+	return true;
+}
+
 bool ElementReader::convert(Element::LineVertex &f, LineVertex &e)
 {
 	if (f.v < 0) f.v = 1 + geometry.size() + f.v;
@@ -118,11 +255,34 @@ bool ElementReader::parse(Element::Face &e)
 		OBJ::Element::FaceVertex &a = e[0];
 		OBJ::Element::FaceVertex &b = e[i];
 		OBJ::Element::FaceVertex &c = e[i - 1];
-		OBJ::Triangle t;
-		if (convert(a, t.a) && convert(b, t.b) && convert(c, t.c)) {
-			if (!parse(t)) status = false;
+		if (batch == BATCH_INDICES) {
+			OBJ::TriangleIndex t;
+			if (convert(a, t.a) && convert(b, t.b) && convert(c, t.c)) {
+				indexBatch.push_back(t);
+				pend(getLine());
+				batchLines.push_back(pending.size() - 1);
+				if (indexBatch.size() >= batchSize) deliver();
+			} else {
+				status = false;
+			}
+		} else if (batch == BATCH_TRIANGLES) {
+			triangleBatch.resize(triangleBatch.size() + 1);
+			OBJ::Triangle &t = triangleBatch.back();
+			if (convert(a, t.a) && convert(b, t.b) && convert(c, t.c)) {
+				pend(getLine());
+				batchLines.push_back(pending.size() - 1);
+				if (triangleBatch.size() >= batchSize) deliver();
+			} else {
+				triangleBatch.pop_back();
+				status = false;
+			}
 		} else {
-			status = false;
+			OBJ::Triangle t;
+			if (convert(a, t.a) && convert(b, t.b) && convert(c, t.c)) {
+				if (!parse(t)) status = false;
+			} else {
+				status = false;
+			}
 		}
 	}
 	return status;
@@ -130,6 +290,7 @@ bool ElementReader::parse(Element::Face &e)
 
 bool ElementReader::parse(Element::Line &e)
 {
+	ElementReader::flush();
 	bool status = true;
 	for (std::size_t i = 1; i < e.size(); i++) {
 		OBJ::Element::LineVertex &a = e[i - 1];
@@ -146,6 +307,7 @@ bool ElementReader::parse(Element::Line &e)
 
 bool ElementReader::parse(Element::Point &e)
 {
+	ElementReader::flush();
 	bool status = true;
 	for (std::size_t i = 0; i < e.size(); i++) {
 		OBJ::Point p;
@@ -3,6 +3,9 @@
 #define _OBJ_ELEMENTREADER_HPP_
 
 #include "Parser.hpp"
+#include <vector>
+#include <string>
+#include <cstddef> // std::size_t
 
 namespace OBJ {
 	
@@ -39,10 +42,38 @@ namespace OBJ {
 		LineVertex a, b;
 	};
 	
+	/* Zero based indices into the v, vt and vn lists */
+	struct VertexIndex {
+		std::size_t position = 0;
+		std::size_t texture  = 0;
+		std::size_t normal   = 0;
+		bool hasTexture = false;
+		bool hasNormal  = false;
+	};
+	
+	struct TriangleIndex {
+		VertexIndex a, b, c;
+	};
+	
+	/* How face triangles are handed to subclasses */
+	enum TriangleBatch {
+		BATCH_NONE,      // parse(Triangle&) per triangle
+		BATCH_TRIANGLES, // triangles(Triangle*, count) with resolved vertices
+		BATCH_INDICES    // triangles(const TriangleIndex*, count), see resolve()
+	};
+	
 	
 	
 	/* Element reader for obj files */
 	class ElementReader : public OBJParser {
+	public:
+		
+		/* Collect up to size triangles before delivering them, BATCH_NONE by default.
+		 * Batches are delivered before lines, points, any other record and done(). */
+		void setTriangleBatch(TriangleBatch mode, std::size_t size = 4096);
+		TriangleBatch getTriangleBatch() const;
+		std::size_t getTriangleBatchSize() const;
+		
 	protected:
 		
 		/* Called for each element */
@@ -50,6 +81,23 @@ namespace OBJ {
 		virtual bool parse(Line &e);
 		virtual bool parse(Point &e);
 		
+		/* Called for each batch, by default pass triangles to parse(Triangle&).
+		 * Call rejectTriangle() with the index of each triangle that fails.
+		 * Invalid lines are held back while a batch is pending and logged
+		 * after it in line order, each once, as they would be without batches. */
+		virtual void triangles(Triangle *t, std::size_t count);
+		virtual void triangles(const TriangleIndex *t, std::size_t count);
+		void rejectTriangle(std::size_t index);
+		
+		/* Vertex lists and lookup for batched indices */
+		const std::vector<Vertex::Geometry>& getGeometry() const;
+		const std::vector<Vertex::Texture>& getTexture() const;
+		const std::vector<Vertex::Normal>& getNormal() const;
+		void resolve(const VertexIndex &i, TriangleVertex &e) const;
+		
+		void flush() override;
+		void invalid(const Range &line) override;
+		
 		bool parse(Vertex::Geometry &v) override;
 		bool parse(Vertex::Texture &v) override;
 		bool parse(Vertex::Normal &v) override;
@@ -63,6 +111,28 @@ namespace OBJ {
 		std::vector<Vertex::Texture> texture;
 		std::vector<Vertex::Normal> normal;
 		
+		TriangleBatch batch = BATCH_NONE;
+		std::size_t batchSize = 4096;
+		std::vector<Triangle> triangleBatch;
+		std::vector<TriangleIndex> indexBatch;
+		std::vector<std::size_t> batchLines;    // Entry in pending of each batched triangle
+		std::vector<std::size_t> batchRejected; // Indices passed to rejectTriangle()
+		
+		/* Lines of batched triangles and invalid lines while a batch is pending */
+		struct PendingLine {
+			std::size_t number;
+			std::size_t offset; // Of the text in pendingText
+			std::size_t size;
+			bool invalid;
+			bool logged;
+		};
+		std::vector<PendingLine> pending;
+		std::string pendingText;
+		std::size_t reported = 0; // Last line logged by deliver()
+		
+		void pend(const Range &line);
+		void deliver();
+		bool convert(Element::FaceVertex &f, VertexIndex &e);
 		bool convert(Element::FaceVertex &f, TriangleVertex &e);
 		bool convert(Element::LineVertex &f, LineVertex &e);
 		bool convert(Element::PointVertex &f, Point &e);
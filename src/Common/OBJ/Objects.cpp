@@ -42,6 +42,43 @@ std::istream& operator>>(std::istream& in, OBJ::Vertex::Normal& obj)
 	return in;
 }
 
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Vertex::Geometry& obj)
+{
+	in >> obj.x >> obj.y >> obj.z;
+	if (in.fail()) return in;
+	in >> obj.w;
+	if (in.fail()) {
+		in.clear();
+		obj.w = 1.0;
+	}
+	return in;
+}
+
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Vertex::Texture& obj)
+{
+	in >> obj.u;
+	if (in.fail()) return in;
+	in >> obj.v;
+	if (in.fail()) {
+		in.clear();
+		obj.v = 0.0;
+		obj.w = 0.0;
+		return in;
+	}
+	in >> obj.w;
+	if (in.fail()) {
+		in.clear();
+		obj.w = 0.0;
+	}
+	return in;
+}
+
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Vertex::Normal& obj)
+{
+	in >> obj.i >> obj.j >> obj.k;
+	return in;
+}
+
 
 
 /* Elements */
@@ -164,6 +201,120 @@ std::istream& operator>>(std::istream& in, OBJ::Element::Face& obj)
 }
 
 
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Element::PointVertex& obj)
+{
+	return in >> obj.v;
+}
+
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Element::Point& obj)
+{
+	while (true) {
+		OBJ::Element::PointVertex v;
+		in >> v;
+		if (in.fail()) {
+			in.clear();
+			break;
+		}
+		obj.push_back(v);
+	}
+	if (obj.empty()) in.setFail();
+	return in;
+}
+
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Element::LineVertex& obj)
+{
+	in >> obj.v;
+	if (in.fail()) return in;
+	if (in.peek() == '/') {
+		in.get();
+		in >> obj.vt;
+		obj.hasTexture = true;
+	} else {
+		obj.vt = 0;
+		obj.hasTexture = false;
+	}
+	return in;
+}
+
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Element::Line& obj)
+{
+	while (true) {
+		OBJ::Range token;
+		in >> token;
+		if (in.fail()) {
+			in.clear();
+			break;
+		}
+		OBJ::Element::LineVertex v;
+		OBJ::Scanner tin(token);
+		tin >> v;
+		if (tin.fail()) {
+			in.setFail();
+			break;
+		}
+		obj.push_back(v);
+	}
+	if (obj.empty()) in.setFail();
+	return in;
+}
+
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Element::FaceVertex& obj)
+{
+	in >> obj.v;
+	if (in.fail()) return in;
+	if (in.peek() == '/') {
+		in.get();
+		if (in.peek() == '/') {
+			in.get();
+			in >> obj.vn;
+			obj.vt = 0;
+			obj.hasTexture = false;
+			obj.hasNormal = true;
+		} else {
+			in >> obj.vt;
+			if (in.fail()) return in;
+			if (in.peek() == '/') {
+				in.get();
+				in >> obj.vn;
+				obj.hasTexture = true;
+				obj.hasNormal = true;
+			} else {
+				obj.vn = 0;
+				obj.hasTexture = true;
+				obj.hasNormal = false;
+			}
+		}
+	} else {
+		obj.vt = 0;
+		obj.vn = 0;
+		obj.hasTexture = false;
+		obj.hasNormal = false;
+	}
+	return in;
+}
+
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Element::Face& obj)
+{
+	while (true) {
+		OBJ::Range token;
+		in >> token;
+		if (in.fail()) {
+			in.clear();
+			break;
+		}
+		OBJ::Element::FaceVertex v;
+		OBJ::Scanner tin(token);
+		tin >> v;
+		if (tin.fail()) {
+			in.setFail();
+			break;
+		}
+		obj.push_back(v);
+	}
+	if (obj.empty()) in.setFail();
+	return in;
+}
+
 
 /* Grouping */
 
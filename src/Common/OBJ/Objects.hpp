@@ -2,6 +2,8 @@
 #ifndef _OBJ_OBJECTS_HPP_
 #define _OBJ_OBJECTS_HPP_
 
+#include "Scanner.hpp"
+#include "SmallVector.hpp"
 #include <vector>
 #include <string>
 #include <istream>
@@ -36,21 +38,21 @@ namespace OBJ { namespace Element {
 		int v;
 	};
 	
-	typedef std::vector<PointVertex> Point;
+	typedef SmallVector<PointVertex, 4> Point;
 	
 	struct LineVertex {
 		int v, vt = 0;
 		bool hasTexture;
 	};
 	
-	typedef std::vector<LineVertex> Line;
+	typedef SmallVector<LineVertex, 4> Line;
 	
 	struct FaceVertex {
 		int v, vt = 0, vn = 0;
 		bool hasTexture, hasNormal;
 	};
 	
-	typedef std::vector<FaceVertex> Face;
+	typedef SmallVector<FaceVertex, 4> Face;
 	
 }} // namespace OBJ::Element
 
@@ -196,6 +198,10 @@ std::istream& operator>>(std::istream& in, OBJ::Vertex::Geometry& obj);
 std::istream& operator>>(std::istream& in, OBJ::Vertex::Texture& obj);
 std::istream& operator>>(std::istream& in, OBJ::Vertex::Normal& obj);
 
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Vertex::Geometry& obj);
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Vertex::Texture& obj);
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Vertex::Normal& obj);
+
 std::istream& operator>>(std::istream& in, OBJ::Element::PointVertex& obj);
 std::istream& operator>>(std::istream& in, OBJ::Element::Point& obj);
 std::istream& operator>>(std::istream& in, OBJ::Element::LineVertex& obj);
@@ -203,6 +209,13 @@ std::istream& operator>>(std::istream& in, OBJ::Element::Line& obj);
 std::istream& operator>>(std::istream& in, OBJ::Element::FaceVertex& obj);
 std::istream& operator>>(std::istream& in, OBJ::Element::Face& obj);
 
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Element::PointVertex& obj);
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Element::Point& obj);
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Element::LineVertex& obj);
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Element::Line& obj);
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Element::FaceVertex& obj);
+OBJ::Scanner& operator>>(OBJ::Scanner& in, OBJ::Element::Face& obj);
+
 std::istream& operator>>(std::istream& in, OBJ::Grouping::Groups& obj);
 std::istream& operator>>(std::istream& in, OBJ::Grouping::Smoothing& obj);
 std::istream& operator>>(std::istream& in, OBJ::Grouping::Merge& obj);
@@ -1,7 +1,18 @@
 #include "Parser.hpp"
-#include <sstream>
+#include "../MappedFile.hpp"
+#include "../ByteScan.hpp"
 #include <fstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>    // std::exception_ptr
+#include <system_error> // std::system_error
+#include <cstdint>      // std::uintptr_t
 
+using OBJ::Range;
+using OBJ::Scanner;
+using OBJ::ReadMode;
 using OBJ::TokenParser;
 using OBJ::OBJParser;
 using OBJ::MTLParser;
@@ -26,30 +37,125 @@ inline std::string getTokenPrefix(const std::string &path)
 	}
 }
 
-inline std::string& inl_ltrim(std::string &s) {
-	std::size_t pos = 0;
-	while (pos < s.size() && !std::isgraph(s[pos])) pos++;
-	return s.erase(0, pos);
+inline const char* inl_find(const char *begin, const char *end, char c) {
+	return scanByte(begin, end, c);
 }
 
-inline std::string& inl_rtrim(std::string &s) {
-	std::size_t pos = s.size();
-	while (pos > 0 && !std::isgraph(s[pos - 1])) pos--;
-	return s.erase(pos);
+inline Range inl_ltrim(Range r) {
+	r.begin = scanGraph(r.begin, r.end);
+	return r;
 }
 
-inline std::string inl_ltoken(const std::string &s) {
-	std::size_t pos = 0;
-	while (pos < s.size() && std::isgraph(s[pos])) pos++;
-	return s.substr(0, pos);
+inline Range inl_rtrim(Range r) {
+	r.end = scanGraphReverse(r.begin, r.end);
+	return r;
 }
 
+inline Range inl_ltoken(Range r) {
+	return Range(r.begin, scanNonGraph(r.begin, r.end));
+}
+
+/* Next line starting at pos, same lines as std::getline on a text mode stream */
+inline Range inl_line(const char *&pos, const char *end) {
+	Range line(pos, inl_find(pos, end, '\n'));
+	pos = line.end < end ? line.end + 1 : line.end;
+#ifdef _WIN32
+	if (pos != line.end && line.begin < line.end && line.end[-1] == '\r') line.end--;
+#endif
+	return line;
+}
+
+/* Size of a seekable stream, 0 when it can't be determined */
+inline std::size_t inl_size(std::istream &in) {
+	std::istream::pos_type start = in.tellg();
+	if (start == std::istream::pos_type(-1) || !in.seekg(0, std::ios::end)) {
+		in.clear();
+		return 0;
+	}
+	std::istream::pos_type end = in.tellg();
+	in.seekg(start);
+	return end == std::istream::pos_type(-1) ? 0 : static_cast<std::size_t>(end - start);
+}
+
+/* Split line into key and arguments, comments and whitespace removed */
+inline void inl_split(const Range &line, Range &key, Range &args) {
+	
+	/* Remove comment */
+	Range copy(line.begin, inl_find(line.begin, line.end, '#'));
+	
+	/* Left and right trim */
+	copy = inl_ltrim(inl_rtrim(copy));
+	
+	/* Retreive key */
+	key = inl_ltoken(copy);
+	copy.begin = key.end;
+	
+	/* Left trim */
+	args = inl_ltrim(copy);
+	
+}
+
+
+
+namespace {
+
+/* Buffers filled by a reader thread ahead of parsing */
+struct ReadAheadQueue {
+	ReadAheadQueue(std::istream &source, std::size_t size, std::size_t depth)
+	: source(source), size(size), storage(depth * (size + alignment)),
+	  buffers(depth), lengths(depth)
+	{
+		for (std::size_t i = 0; i < depth; i++) {
+			char *base = storage.data() + i * (size + alignment);
+			std::size_t offset = reinterpret_cast<std::uintptr_t>(base) % alignment;
+			buffers[i] = offset ? base + alignment - offset : base;
+		}
+	}
+	static const std::size_t alignment = 4096;
+	std::istream &source;
+	std::size_t size;
+	std::vector<char> storage;
+	std::vector<char*> buffers;
+	std::vector<std::size_t> lengths;
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::size_t produced = 0, consumed = 0;
+	bool finished = false, stop = false;
+};
+
+void readAheadWorker(ReadAheadQueue &queue) {
+	std::unique_lock<std::mutex> lock(queue.mutex);
+	while (true) {
+		queue.cond.wait(lock, [&] {
+			return queue.stop || queue.produced < queue.consumed + queue.buffers.size();
+		});
+		if (queue.stop) break;
+		std::size_t slot = queue.produced % queue.buffers.size();
+		lock.unlock();
+		queue.source.read(queue.buffers[slot], queue.size);
+		std::size_t length = static_cast<std::size_t>(queue.source.gcount());
+		bool more = !queue.source.fail();
+		lock.lock();
+		queue.lengths[slot] = length;
+		queue.produced++;
+		queue.finished = !more;
+		queue.cond.notify_all();
+		if (!more) break;
+	}
+}
+
+} // namespace
+
 
 
 /* TokenParser */
 
+static const std::size_t progressStep = 1 << 20;
+
 TokenParser::TokenParser()
-: logger(&ostream_sink), lineNumber(0)
+: logger(&ostream_sink), lineNumber(0),
+  bytesRead(0), bytesTotal(0), bytesReport(0), mode(READ_STREAM),
+  aheadSize(16 << 20), aheadDepth(3), in(&buffer)
 {}
 
 void TokenParser::read(const std::string& filename)
@@ -60,17 +166,43 @@ void TokenParser::read(const std::string& filename)
 void TokenParser::read(const std::string& filename, std::ostream& log)
 {
 	prefix = getTokenPrefix(filename);
-	std::ifstream file;
 	log << "[" << prefix << "] Opening for reading.\n";
-	file.open(filename, std::ios::in);
-	if (file.is_open()) {
-		read(file, log);
-		if (file.bad()) log << "[" << prefix << "] IO Error.\n";
-		log << "[" << prefix << "] Closing.\n";
-		file.close();
+	if (mode == READ_MAPPED) {
+		MappedFile file;
+		if (file.open(filename)) {
+			read(Range(file.data(), file.data() + file.size()), log);
+			log << "[" << prefix << "] Closing.\n";
+			file.close();
+		} else {
+			log << "[" << prefix << "] Failed to open for reading.\n";
+		}
+	} else if (mode == READ_AHEAD) {
+		std::ifstream file;
+		file.rdbuf()->pubsetbuf(nullptr, 0);
+		file.open(filename, std::ios::in | std::ios::binary);
+		if (file.is_open()) {
+			bytesTotal = inl_size(file);
+			readAhead(file, log);
+			if (file.bad()) log << "[" << prefix << "] IO Error.\n";
+			log << "[" << prefix << "] Closing.\n";
+			file.close();
+		} else {
+			log << "[" << prefix << "] Failed to open for reading.\n";
+		}
 	} else {
-		log << "[" << prefix << "] Failed to open for reading.\n";
+		std::ifstream file;
+		file.open(filename, std::ios::in);
+		if (file.is_open()) {
+			bytesTotal = inl_size(file);
+			read(file, log);
+			if (file.bad()) log << "[" << prefix << "] IO Error.\n";
+			log << "[" << prefix << "] Closing.\n";
+			file.close();
+		} else {
+			log << "[" << prefix << "] Failed to open for reading.\n";
+		}
 	}
+	bytesTotal = 0;
 	log << std::flush;
 }
 
@@ -83,19 +215,143 @@ void TokenParser::read(std::istream& source, std::ostream& log)
 {
 	logger = &log;
 	lineNumber = 0;
+	bytesRead = bytesReport = 0;
 	for (std::string line; std::getline(source, line); ) {
 		lineNumber++;
-		if (parse(line)) continue;
-		if (!prefix.empty()) log << "[" << prefix << "] ";
-		log << "Invalid line " << lineNumber << ": " << line << "\n";
+		if (!parseLine(line)) invalid(line);
+		advance(line.size() + 1);
+	}
+	flush();
+	progress(bytesRead, bytesTotal);
+	done();
+	logger = &ostream_sink;
+}
+
+void TokenParser::read(const Range& source)
+{
+	read(source, ostream_sink);
+}
+
+void TokenParser::read(const Range& source, std::ostream& log)
+{
+	logger = &log;
+	lineNumber = 0;
+	bytesRead = bytesReport = 0;
+	bytesTotal = source.size();
+	lines(source);
+	flush();
+	progress(bytesRead, bytesTotal);
+	done();
+	bytesTotal = 0;
+	logger = &ostream_sink;
+}
+
+void TokenParser::readAhead(std::istream& source, std::ostream& log)
+{
+	logger = &log;
+	lineNumber = 0;
+	bytesRead = bytesReport = 0;
+	ReadAheadQueue queue(source, aheadSize, aheadDepth);
+	std::thread reader(readAheadWorker, std::ref(queue));
+	try {
+		std::string carry;
+		for (std::size_t index = 0; ; index++) {
+			std::size_t slot = index % queue.buffers.size();
+			{
+				std::unique_lock<std::mutex> lock(queue.mutex);
+				queue.cond.wait(lock, [&] {
+					return index < queue.produced || queue.finished;
+				});
+				if (index >= queue.produced) break;
+			}
+			const char *begin = queue.buffers[slot];
+			const char *end   = begin + queue.lengths[slot];
+			
+			/* Finish the line started in the previous buffer */
+			if (!carry.empty()) {
+				const char *split = inl_find(begin, end, '\n');
+				if (split < end) split++;
+				carry.append(begin, split);
+				begin = split;
+				if (carry[carry.size() - 1] == '\n') {
+					lines(Range(carry));
+					carry.clear();
+				}
+			}
+			
+			/* Parse complete lines in place, keep the rest for the next buffer */
+			const char *last = end;
+			while (last > begin && last[-1] != '\n') last--;
+			lines(Range(begin, last));
+			carry.append(last, end);
+			
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.consumed++;
+			queue.cond.notify_all();
+		}
+		lines(Range(carry));
+	} catch (...) {
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.stop = true;
+			queue.cond.notify_all();
+		}
+		reader.join();
+		logger = &ostream_sink;
+		throw;
 	}
+	reader.join();
+	flush();
+	progress(bytesRead, bytesTotal);
 	done();
 	logger = &ostream_sink;
 }
 
+void TokenParser::setReadMode(ReadMode mode)
+{
+	this->mode = mode;
+}
+
+ReadMode TokenParser::getReadMode() const
+{
+	return mode;
+}
+
+void TokenParser::setReadAhead(std::size_t bufferSize, std::size_t depth)
+{
+	aheadSize  = bufferSize > 0 ? bufferSize : 1;
+	aheadDepth = depth > 0 ? depth : 1;
+}
+
+std::size_t TokenParser::getReadAheadSize() const
+{
+	return aheadSize;
+}
+
+std::size_t TokenParser::getReadAheadDepth() const
+{
+	return aheadDepth;
+}
+
 void TokenParser::done()
 {}
 
+void TokenParser::flush()
+{}
+
+void TokenParser::progress(std::size_t, std::size_t)
+{}
+
+void TokenParser::lines(const Range& source)
+{
+	for (const char *pos = source.begin; pos < source.end; ) {
+		Range line = inl_line(pos, source.end);
+		lineNumber++;
+		if (!parseLine(line)) invalid(line);
+		advance(pos - line.begin);
+	}
+}
+
 std::ostream& TokenParser::getLogger() const
 {
 	return *logger;
@@ -106,79 +362,358 @@ std::size_t TokenParser::getLineNumber() const
 	return lineNumber;
 }
 
-bool TokenParser::parse(const std::string& line)
+std::size_t TokenParser::getBytesRead() const
 {
-	/* Copy line */
-	std::string copy = line;
-	
-	/* Remove comment */
-	std::string::size_type n = copy.find('#');
-	if (n != std::string::npos) copy.erase(n);
-	
-	/* Left and right trim */
-	copy = inl_ltrim(inl_rtrim(copy));
-	
-	/* Retreive key */
-	std::string key = inl_ltoken(copy);
-	copy.erase(0, key.size());
-	
-	/* Left trim */
-	copy = inl_ltrim(copy);
+	return bytesRead;
+}
+
+std::size_t TokenParser::getBytesTotal() const
+{
+	return bytesTotal;
+}
+
+void TokenParser::advance(std::size_t bytes)
+{
+	bytesRead += bytes;
+	if (bytesTotal > 0 && bytesRead > bytesTotal) bytesRead = bytesTotal;
+	if (bytesRead < bytesReport) return;
+	bytesReport = bytesRead + progressStep;
+	progress(bytesRead, bytesTotal);
+}
+
+std::istream& TokenParser::stream(const Range& args)
+{
+	buffer.reset(args);
+	in.clear();
+	return in;
+}
+
+bool TokenParser::parseLine(const Range& line)
+{
+	this->line = line;
+	Range key, args;
+	inl_split(line, key, args);
 	
 	/* Nothing to parse */
 	if (key.empty()) return true;
 	
-	/* Create istream */
-	std::istringstream in(copy);
-	
 	/* Call virtual token method */
-	return token(key, in);
+	return token(key, args);
+}
+
+void TokenParser::invalid(const Range& line)
+{
+	logInvalid(lineNumber, line);
+}
+
+void TokenParser::logInvalid(std::size_t number, const Range& line)
+{
+	if (!prefix.empty()) *logger << "[" << prefix << "] ";
+	*logger << "Invalid line " << number << ": ";
+	logger->write(line.begin, line.size());
+	*logger << "\n";
+}
+
+const Range& TokenParser::getLine() const
+{
+	return line;
+}
+
+void TokenParser::setLine(std::size_t number, const Range& line)
+{
+	lineNumber = number;
+	this->line = line;
+}
+
+void TokenParser::setLineNumber(std::size_t number)
+{
+	lineNumber = number;
 }
 
 
 
 /* OBJParser */
 
+namespace {
+
+/* Lines of a chunk are split into records ahead of dispatch */
+enum ChunkRecordType {
+	RECORD_LINE,     // Dispatched through token()
+	RECORD_INVALID,  // Failed to parse
+	RECORD_GEOMETRY, // v
+	RECORD_TEXTURE,  // vt
+	RECORD_NORMAL,   // vn
+	RECORD_FACE      // f
+};
+
+struct ChunkRecord {
+	Range line;
+	std::size_t number;
+	std::size_t corners;
+	ChunkRecordType type;
+};
+
+struct ParsedChunk {
+	Range source;
+	std::size_t lines = 0;
+	bool ready = false;
+	std::vector<ChunkRecord> records;
+	std::vector<OBJ::Vertex::Geometry> geometry;
+	std::vector<OBJ::Vertex::Texture> texture;
+	std::vector<OBJ::Vertex::Normal> normal;
+	std::vector<OBJ::Element::FaceVertex> corners;
+};
+
+struct ChunkQueue {
+	ChunkQueue(const Range &source, std::size_t depth)
+	: slots(depth), next(source.begin), end(source.end)
+	{}
+	void halt() {
+		std::lock_guard<std::mutex> lock(mutex);
+		next = end;
+		cond.notify_all();
+	}
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::vector<ParsedChunk> slots;
+	const char *next, *end;
+	std::size_t issued = 0, merged = 0;
+	std::exception_ptr error;
+};
+
+static const std::size_t chunkSize = 1 << 20;
+
+template<typename T>
+inline ChunkRecordType inl_record(const Range &args, std::vector<T> &out, ChunkRecordType type) {
+	Scanner in(args);
+	T obj;
+	in >> obj;
+	if (in.fail()) return RECORD_INVALID;
+	out.push_back(obj);
+	return type;
+}
+
+void parseChunk(ParsedChunk &chunk) {
+	chunk.lines = 0;
+	chunk.records.clear();
+	chunk.geometry.clear();
+	chunk.texture.clear();
+	chunk.normal.clear();
+	chunk.corners.clear();
+	for (const char *pos = chunk.source.begin; pos < chunk.source.end; ) {
+		ChunkRecord r;
+		r.line = inl_line(pos, chunk.source.end);
+		r.number = ++chunk.lines;
+		r.corners = 0;
+		Range key, args;
+		inl_split(r.line, key, args);
+		if (key.empty()) continue;
+		if (key.equals("v")) {
+			r.type = inl_record(args, chunk.geometry, RECORD_GEOMETRY);
+		} else if (key.equals("vt")) {
+			r.type = inl_record(args, chunk.texture, RECORD_TEXTURE);
+		} else if (key.equals("vn")) {
+			r.type = inl_record(args, chunk.normal, RECORD_NORMAL);
+		} else if (key.equals("f")) {
+			Scanner in(args);
+			OBJ::Element::Face face;
+			in >> face;
+			if (in.fail()) {
+				r.type = RECORD_INVALID;
+			} else {
+				r.type = RECORD_FACE;
+				r.corners = face.size();
+				chunk.corners.insert(chunk.corners.end(), face.begin(), face.end());
+			}
+		} else {
+			r.type = RECORD_LINE;
+		}
+		chunk.records.push_back(r);
+	}
+}
+
+void chunkWorker(ChunkQueue &queue) {
+	std::unique_lock<std::mutex> lock(queue.mutex);
+	while (true) {
+		queue.cond.wait(lock, [&] {
+			return queue.next == queue.end || queue.issued < queue.merged + queue.slots.size();
+		});
+		if (queue.next == queue.end) return;
+		ParsedChunk &chunk = queue.slots[queue.issued % queue.slots.size()];
+		queue.issued++;
+		const char *begin = queue.next;
+		const char *split = static_cast<std::size_t>(queue.end - begin) > chunkSize ? begin + chunkSize : queue.end;
+		split = inl_find(split, queue.end, '\n');
+		if (split < queue.end) split++;
+		queue.next = split;
+		chunk.source = Range(begin, split);
+		lock.unlock();
+		try {
+			parseChunk(chunk);
+		} catch (...) {
+			lock.lock();
+			if (!queue.error) queue.error = std::current_exception();
+			queue.next = queue.end;
+			queue.cond.notify_all();
+			return;
+		}
+		lock.lock();
+		chunk.ready = true;
+		queue.cond.notify_all();
+	}
+}
+
+} // namespace
+
+
 template<typename T>
-bool OBJParser::parser(std::istream& in)
+bool OBJParser::parser(const Range& args)
 {
+	std::istream& in = stream(args);
 	T obj;
 	in >> obj;
 	if (in.fail()) return false;
+	flush();
 	return parse(obj);
 }
 
-bool OBJParser::token(const std::string& t, std::istream& in)
+template<typename T>
+bool OBJParser::scanner(const Range& args)
 {
-	/* Vertex data */
-	if (t.compare("v")  == 0) return parser<OBJ::Vertex::Geometry>(in);
-	if (t.compare("vn") == 0) return parser<OBJ::Vertex::Normal>(in);
-	if (t.compare("vt") == 0) return parser<OBJ::Vertex::Texture>(in);
-	
-	/* Elements */
-	if (t.compare("p")  == 0) return parser<OBJ::Element::Point>(in);
-	if (t.compare("l")  == 0) return parser<OBJ::Element::Line>(in);
-	if (t.compare("f")  == 0) return parser<OBJ::Element::Face>(in);
-	
-	/* Grouping */
-	if (t.compare("g")  == 0) return parser<OBJ::Grouping::Groups>(in);
-	if (t.compare("s")  == 0) return parser<OBJ::Grouping::Smoothing>(in);
-	if (t.compare("mg") == 0) return parser<OBJ::Grouping::Merge>(in);
-	if (t.compare("o")  == 0) return parser<OBJ::Grouping::Object>(in);
-	
-	/* Display/render attributes */
-	if (t.compare("bevel")      == 0) return parser<OBJ::Render::Bevel>(in);
-	if (t.compare("c_interp")   == 0) return parser<OBJ::Render::ColorInterpolation>(in);
-	if (t.compare("d_interp")   == 0) return parser<OBJ::Render::DissolveInterpolation>(in);
-	if (t.compare("lod")        == 0) return parser<OBJ::Render::LevelOfDetail>(in);
-	if (t.compare("usemtl")     == 0) return parser<OBJ::Render::UseMaterial>(in);
-	if (t.compare("mtllib")     == 0) return parser<OBJ::Render::MaterialLib>(in);
-	if (t.compare("shadow_obj") == 0) return parser<OBJ::Render::ShadowObject>(in);
-	if (t.compare("trace_obj")  == 0) return parser<OBJ::Render::TraceObject>(in);
+	Scanner in(args);
+	T obj;
+	in >> obj;
+	if (in.fail()) return false;
+	return parse(obj);
+}
+
+bool OBJParser::token(const Range& t, const Range& args)
+{
+	/* Keywords are told apart by length and first character */
+	const char *c = t.begin;
+	switch (t.size()) {
+	case 1:
+		switch (c[0]) {
+		case 'v': return scanner<OBJ::Vertex::Geometry>(args);
+		case 'p': return scanner<OBJ::Element::Point>(args);
+		case 'l': return scanner<OBJ::Element::Line>(args);
+		case 'f': return scanner<OBJ::Element::Face>(args);
+		case 'g': return parser<OBJ::Grouping::Groups>(args);
+		case 's': return parser<OBJ::Grouping::Smoothing>(args);
+		case 'o': return parser<OBJ::Grouping::Object>(args);
+		}
+		break;
+	case 2:
+		if (c[0] == 'v' && c[1] == 'n') return scanner<OBJ::Vertex::Normal>(args);
+		if (c[0] == 'v' && c[1] == 't') return scanner<OBJ::Vertex::Texture>(args);
+		if (c[0] == 'm' && c[1] == 'g') return parser<OBJ::Grouping::Merge>(args);
+		break;
+	case 3:
+		if (t.equals("lod")) return parser<OBJ::Render::LevelOfDetail>(args);
+		break;
+	case 5:
+		if (t.equals("bevel")) return parser<OBJ::Render::Bevel>(args);
+		break;
+	case 6:
+		if (c[0] == 'u' && t.equals("usemtl")) return parser<OBJ::Render::UseMaterial>(args);
+		if (c[0] == 'm' && t.equals("mtllib")) return parser<OBJ::Render::MaterialLib>(args);
+		break;
+	case 8:
+		if (c[0] == 'c' && t.equals("c_interp")) return parser<OBJ::Render::ColorInterpolation>(args);
+		if (c[0] == 'd' && t.equals("d_interp")) return parser<OBJ::Render::DissolveInterpolation>(args);
+		break;
+	case 9:
+		if (t.equals("trace_obj")) return parser<OBJ::Render::TraceObject>(args);
+		break;
+	case 10:
+		if (t.equals("shadow_obj")) return parser<OBJ::Render::ShadowObject>(args);
+		break;
+	}
+	flush();
+	return custom(t, args);
+}
+
+void OBJParser::setThreads(unsigned threads)
+{
+	this->threads = threads > 0 ? threads : 1;
+}
+
+unsigned OBJParser::getThreads() const
+{
+	return threads;
+}
+
+void OBJParser::lines(const Range& source)
+{
+	if (threads <= 1) {
+		TokenParser::lines(source);
+		return;
+	}
 	
-	return false;
+	/* Workers parse chunks ahead, at most 2 per thread are kept in memory */
+	ChunkQueue queue(source, 2 * threads);
+	std::vector<std::thread> workers;
+	try {
+		try {
+			for (unsigned i = 0; i < threads; i++) {
+				workers.push_back(std::thread(chunkWorker, std::ref(queue)));
+			}
+		} catch (std::system_error&) {
+			if (workers.empty()) {
+				TokenParser::lines(source);
+				return;
+			}
+		}
+		
+		/* Dispatch records in file order, exactly as the serial path would */
+		std::size_t base = getLineNumber();
+		for (std::size_t index = 0; ; index++) {
+			ParsedChunk &chunk = queue.slots[index % queue.slots.size()];
+			{
+				std::unique_lock<std::mutex> lock(queue.mutex);
+				queue.cond.wait(lock, [&] {
+					return chunk.ready || queue.error || (queue.next == queue.end && index == queue.issued);
+				});
+				if (queue.error) std::rethrow_exception(queue.error);
+				if (!chunk.ready) break;
+			}
+			std::size_t geometry = 0, texture = 0, normal = 0, corner = 0;
+			for (std::size_t i = 0; i < chunk.records.size(); i++) {
+				const ChunkRecord &r = chunk.records[i];
+				setLine(base + r.number, r.line);
+				bool valid = false;
+				switch (r.type) {
+				case RECORD_LINE:     valid = parseLine(r.line); break;
+				case RECORD_GEOMETRY: valid = parse(chunk.geometry[geometry++]); break;
+				case RECORD_TEXTURE:  valid = parse(chunk.texture[texture++]); break;
+				case RECORD_NORMAL:   valid = parse(chunk.normal[normal++]); break;
+				case RECORD_FACE: {
+					OBJ::Element::Face face;
+					for (std::size_t j = 0; j < r.corners; j++) face.push_back(chunk.corners[corner++]);
+					valid = parse(face);
+					break;
+				}
+				case RECORD_INVALID: break;
+				}
+				if (!valid) invalid(r.line);
+			}
+			base += chunk.lines;
+			setLineNumber(base);
+			advance(chunk.source.size());
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			chunk.ready = false;
+			queue.merged++;
+			queue.cond.notify_all();
+		}
+	} catch (...) {
+		queue.halt();
+		for (std::size_t i = 0; i < workers.size(); i++) workers[i].join();
+		throw;
+	}
+	for (std::size_t i = 0; i < workers.size(); i++) workers[i].join();
 }
 
+bool OBJParser::custom(const Range&, const Range&)         { return false; }
 bool OBJParser::parse(OBJ::Vertex::Geometry&)              { return false; }
 bool OBJParser::parse(OBJ::Vertex::Texture&)               { return false; }
 bool OBJParser::parse(OBJ::Vertex::Normal&)                { return false; }
@@ -203,37 +738,65 @@ bool OBJParser::parse(OBJ::Render::TraceObject&)           { return false;}
 /* MTLParser */
 
 template<typename T>
-bool MTLParser::parser(std::istream& in)
+bool MTLParser::parser(const Range& args)
 {
+	std::istream& in = stream(args);
 	T obj;
 	in >> obj;
 	if (in.fail()) return false;
 	return parse(obj);
 }
 
-bool MTLParser::token(const std::string& t, std::istream& in)
-{
-	if (t.compare("newmtl")   == 0) return parser<OBJ::MTL::NewMaterial>(in);
-	if (t.compare("Ka")       == 0) return parser<OBJ::MTL::AmbientColor>(in);
-	if (t.compare("Kd")       == 0) return parser<OBJ::MTL::DiffuseColor>(in);
-	if (t.compare("Ks")       == 0) return parser<OBJ::MTL::SpecularColor>(in);
-	if (t.compare("Ke")       == 0) return parser<OBJ::MTL::EmissionColor>(in);
-	if (t.compare("d")        == 0) return parser<OBJ::MTL::Dissolve>(in);
-	if (t.compare("Tr")       == 0) return parser<OBJ::MTL::Dissolve>(in);
-	if (t.compare("illum")    == 0) return parser<OBJ::MTL::IlluminationModel>(in);
-	if (t.compare("Ns")       == 0) return parser<OBJ::MTL::SpecularExponent>(in);
-	if (t.compare("Ni")       == 0) return parser<OBJ::MTL::RefractionIndex>(in);
-	if (t.compare("Tf")       == 0) return parser<OBJ::MTL::TransmittionFilter>(in);
-	if (t.compare("map_Ka")   == 0) return parser<OBJ::MTL::AmbientMap>(in);
-	if (t.compare("map_Kd")   == 0) return parser<OBJ::MTL::DiffuseMap>(in);
-	if (t.compare("map_Ks")   == 0) return parser<OBJ::MTL::SpecularColorMap>(in);
-	if (t.compare("map_Ns")   == 0) return parser<OBJ::MTL::SpeculaHighlightMap>(in);
-	if (t.compare("map_d")    == 0) return parser<OBJ::MTL::AlphaMap>(in);
-	if (t.compare("map_bump") == 0) return parser<OBJ::MTL::BumpMap>(in);
-	if (t.compare("bump")     == 0) return parser<OBJ::MTL::BumpMap>(in);
-	return false;
+bool MTLParser::token(const Range& t, const Range& args)
+{
+	/* Keywords are told apart by length and first character */
+	const char *c = t.begin;
+	switch (t.size()) {
+	case 1:
+		if (c[0] == 'd') return parser<OBJ::MTL::Dissolve>(args);
+		break;
+	case 2:
+		switch (c[0]) {
+		case 'K':
+			if (c[1] == 'a') return parser<OBJ::MTL::AmbientColor>(args);
+			if (c[1] == 'd') return parser<OBJ::MTL::DiffuseColor>(args);
+			if (c[1] == 's') return parser<OBJ::MTL::SpecularColor>(args);
+			if (c[1] == 'e') return parser<OBJ::MTL::EmissionColor>(args);
+			break;
+		case 'N':
+			if (c[1] == 's') return parser<OBJ::MTL::SpecularExponent>(args);
+			if (c[1] == 'i') return parser<OBJ::MTL::RefractionIndex>(args);
+			break;
+		case 'T':
+			if (c[1] == 'r') return parser<OBJ::MTL::Dissolve>(args);
+			if (c[1] == 'f') return parser<OBJ::MTL::TransmittionFilter>(args);
+			break;
+		}
+		break;
+	case 4:
+		if (t.equals("bump")) return parser<OBJ::MTL::BumpMap>(args);
+		break;
+	case 5:
+		if (c[0] == 'i' && t.equals("illum")) return parser<OBJ::MTL::IlluminationModel>(args);
+		if (c[0] == 'm' && t.equals("map_d")) return parser<OBJ::MTL::AlphaMap>(args);
+		break;
+	case 6:
+		if (c[0] == 'n' && t.equals("newmtl")) return parser<OBJ::MTL::NewMaterial>(args);
+		if (c[0] == 'm' && c[1] == 'a' && c[2] == 'p' && c[3] == '_') {
+			if (c[4] == 'K' && c[5] == 'a') return parser<OBJ::MTL::AmbientMap>(args);
+			if (c[4] == 'K' && c[5] == 'd') return parser<OBJ::MTL::DiffuseMap>(args);
+			if (c[4] == 'K' && c[5] == 's') return parser<OBJ::MTL::SpecularColorMap>(args);
+			if (c[4] == 'N' && c[5] == 's') return parser<OBJ::MTL::SpeculaHighlightMap>(args);
+		}
+		break;
+	case 8:
+		if (t.equals("map_bump")) return parser<OBJ::MTL::BumpMap>(args);
+		break;
+	}
+	return custom(t, args);
 }
 
+bool MTLParser::custom(const Range&, const Range&) { return false; }
 bool MTLParser::parse(MTL::NewMaterial&)         { return false; }
 bool MTLParser::parse(MTL::AmbientColor&)        { return false; }
 bool MTLParser::parse(MTL::DiffuseColor&)        { return false; }
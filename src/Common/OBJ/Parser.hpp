@@ -3,6 +3,7 @@
 #define _OBJ_PARSER_HPP_
 
 #include "Objects.hpp"
+#include "Range.hpp"
 #include <string>
 #include <istream>
 #include <ostream>
@@ -23,6 +24,15 @@ namespace OBJ {
 	
 	
 	
+	/* How read(filename) accesses the file */
+	enum ReadMode {
+		READ_STREAM, // std::ifstream, line by line
+		READ_MAPPED, // Memory-mapped, lines are parsed in place
+		READ_AHEAD   // Reader thread fills buffers while the previous ones are parsed
+	};
+	
+	
+	
 	/* Base token parser */
 	class TokenParser {
 	public:
@@ -32,20 +42,68 @@ namespace OBJ {
 		void read(const std::string &filename, std::ostream &log);
 		void read(std::istream &source);
 		void read(std::istream &source, std::ostream &log);
+		void read(const Range &source);
+		void read(const Range &source, std::ostream &log);
+		void setReadMode(ReadMode mode);
+		ReadMode getReadMode() const;
+		void setReadAhead(std::size_t bufferSize, std::size_t depth);
+		std::size_t getReadAheadSize() const;
+		std::size_t getReadAheadDepth() const;
 		std::ostream& getLogger() const;
 		std::size_t getLineNumber() const;
 		
+		/* Bytes parsed so far and file size, total is 0 when unknown */
+		std::size_t getBytesRead() const;
+		std::size_t getBytesTotal() const;
+		
 	protected:
 		
 		virtual void done();
-		virtual bool token(const std::string &t, std::istream &in) = 0;
+		
+		/* Called before done(), subclasses that hold back output deliver it here.
+		 * OBJParser also calls it before records other than v, vt, vn, p, l and f. */
+		virtual void flush();
+		
+		/* Called about every megabyte read and once at the end */
+		virtual void progress(std::size_t bytes, std::size_t total);
+		virtual bool token(const Range &t, const Range &args) = 0;
+		
+		/* Parse every line of source, called by read(source) */
+		virtual void lines(const Range &source);
+		
+		/* Parse a single line, returns false if it is invalid */
+		bool parseLine(const Range &line);
+		
+		/* Called for each invalid line, logs it by default */
+		virtual void invalid(const Range &line);
+		void logInvalid(std::size_t number, const Range &line);
+		
+		/* Line being parsed, only valid until the next one */
+		const Range& getLine() const;
+		void setLine(std::size_t number, const Range &line);
+		void setLineNumber(std::size_t number);
+		
+		/* Count parsed bytes, calls progress() */
+		void advance(std::size_t bytes);
+		
+		/* Stream over args, reused between lines */
+		std::istream& stream(const Range &args);
 		
 	private:
 		
-		bool parse(const std::string &line);
+		void readAhead(std::istream &source, std::ostream &log);
 		std::string prefix;
 		std::ostream *logger;
 		std::size_t lineNumber;
+		Range line;
+		std::size_t bytesRead;
+		std::size_t bytesTotal;
+		std::size_t bytesReport;
+		ReadMode mode;
+		std::size_t aheadSize;
+		std::size_t aheadDepth;
+		RangeBuffer buffer;
+		std::istream in;
 		
 	};
 	
@@ -53,6 +111,14 @@ namespace OBJ {
 	
 	/* Base obj parser */
 	class OBJParser : public TokenParser {
+	public:
+		
+		/* Parse v, vt, vn and f records of read(source) on this many threads.
+		 * Those records then go to parse() directly, without token(), so a
+		 * subclass that overrides token() must keep a single thread. */
+		void setThreads(unsigned threads);
+		unsigned getThreads() const;
+		
 	protected:
 		
 		/* Vertex data */
@@ -81,11 +147,20 @@ namespace OBJ {
 		virtual bool parse(Render::ShadowObject& r);          // shadow_obj
 		virtual bool parse(Render::TraceObject& r);           // trace_obj
 		
+		/* Called for keywords not listed above */
+		virtual bool custom(const Range &t, const Range &args);
+		
+		void lines(const Range &source) override;
+		
 	private:
 		
+		unsigned threads = 1;
+		
 		template<typename T>
-		bool parser(std::istream& in);
-		bool token(const std::string &t, std::istream &in) override;
+		bool parser(const Range &args);
+		template<typename T>
+		bool scanner(const Range &args);
+		bool token(const Range &t, const Range &args) override;
 		
 	};
 	
@@ -112,11 +187,14 @@ namespace OBJ {
 		virtual bool parse(MTL::AlphaMap& m);            // map_d
 		virtual bool parse(MTL::BumpMap& m);             // map_bump | bump
 		
+		/* Called for keywords not listed above */
+		virtual bool custom(const Range &t, const Range &args);
+		
 	private:
 		
 		template<typename T>
-		bool parser(std::istream& in);
-		bool token(const std::string& t, std::istream& in) override;
+		bool parser(const Range &args);
+		bool token(const Range &t, const Range &args) override;
 		
 	};
 	
@@ -0,0 +1,72 @@
+#include "Range.hpp"
+#include <cstring> // std::memcmp, std::strlen
+
+using OBJ::Range;
+using OBJ::RangeBuffer;
+
+
+
+/* Range */
+
+Range::Range()
+: begin(nullptr), end(nullptr)
+{}
+
+Range::Range(const char *begin, const char *end)
+: begin(begin), end(end)
+{}
+
+Range::Range(const std::string &str)
+: begin(str.data()), end(str.data() + str.size())
+{}
+
+std::size_t Range::size() const
+{
+	return static_cast<std::size_t>(end - begin);
+}
+
+bool Range::empty() const
+{
+	return begin == end;
+}
+
+bool Range::equals(const char *str) const
+{
+	std::size_t length = std::strlen(str);
+	return length == size() && std::memcmp(begin, str, length) == 0;
+}
+
+std::string Range::str() const
+{
+	return std::string(begin, end);
+}
+
+
+
+/* RangeBuffer */
+
+RangeBuffer::RangeBuffer()
+{}
+
+void RangeBuffer::reset(const Range &range)
+{
+	char *begin = const_cast<char*>(range.begin);
+	char *end   = const_cast<char*>(range.end);
+	setg(begin, begin, end);
+}
+
+RangeBuffer::pos_type RangeBuffer::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+	if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+	off_type pos = off;
+	if (dir == std::ios_base::cur) pos += gptr() - eback();
+	if (dir == std::ios_base::end) pos += egptr() - eback();
+	if (pos < 0 || pos > egptr() - eback()) return pos_type(off_type(-1));
+	setg(eback(), eback() + pos, egptr());
+	return pos_type(pos);
+}
+
+RangeBuffer::pos_type RangeBuffer::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+	return seekoff(off_type(pos), std::ios_base::beg, which);
+}
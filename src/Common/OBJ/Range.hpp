@@ -0,0 +1,60 @@
+#pragma once
+#ifndef _OBJ_RANGE_HPP_
+#define _OBJ_RANGE_HPP_
+
+#include <string>
+#include <streambuf>
+#include <cstddef> // std::size_t
+
+namespace OBJ {
+	
+	
+	
+	class Range;
+	class RangeBuffer;
+	
+	
+	
+	/* Non-owning view of the characters [begin, end) */
+	class Range {
+	public:
+		
+		Range();
+		Range(const char *begin, const char *end);
+		Range(const std::string &str);
+		
+		std::size_t size() const;
+		bool empty() const;
+		
+		/* Compare with a null-terminated string */
+		bool equals(const char *str) const;
+		
+		/* Copy into a string */
+		std::string str() const;
+		
+		const char *begin;
+		const char *end;
+		
+	};
+	
+	
+	
+	/* Read-only stream buffer over a range, nothing is copied */
+	class RangeBuffer : public std::streambuf {
+	public:
+		
+		RangeBuffer();
+		void reset(const Range &range);
+		
+	protected:
+		
+		pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+		pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+		
+	};
+	
+	
+	
+} // namespace OBJ
+
+#endif // _OBJ_RANGE_HPP_
@@ -0,0 +1,191 @@
+#include "Scanner.hpp"
+#include <sstream>
+#include <locale>
+#include <limits>
+#include <cstring> // std::memcpy
+#include <cstdint> // std::uint64_t
+
+using OBJ::Range;
+using OBJ::Scanner;
+
+static const double pow10[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+	1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+	1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline bool inl_isspace(char c) {
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+inline bool inl_isdigit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+/* Rounding a double to float gives the same result as rounding the exact value */
+inline bool inl_floatsafe(double d) {
+	if (d < std::numeric_limits<float>::min()) return false;
+	std::uint64_t bits;
+	std::memcpy(&bits, &d, sizeof(bits));
+	return (bits & 0x1FFFFFFF) != 0x10000000;
+}
+
+
+
+Scanner::Scanner(const Range &range)
+: pos(range.begin), end(range.end), failed(false)
+{}
+
+Scanner& Scanner::operator>>(float &v)
+{
+	if (!skip()) return *this;
+	const char *begin = pos;
+	
+	/* Sign */
+	bool negative = false;
+	if (pos < end && (*pos == '+' || *pos == '-')) negative = *pos++ == '-';
+	
+	/* Mantissa */
+	std::uint64_t mantissa = 0;
+	int digits   = 0;
+	int exponent = 0;
+	bool found = false, dot = false;
+	for (; pos < end; pos++) {
+		if (inl_isdigit(*pos)) {
+			found = true;
+			if (mantissa == 0 && *pos == '0') {
+				if (dot) exponent--;
+			} else if (++digits <= 19) {
+				mantissa = mantissa * 10 + (*pos - '0');
+				if (dot) exponent--;
+			}
+		} else if (*pos == '.' && !dot) {
+			dot = true;
+		} else {
+			break;
+		}
+	}
+	
+	/* Exponent */
+	if (found && pos < end && (*pos == 'e' || *pos == 'E')) {
+		pos++;
+		bool negativeExp = false;
+		if (pos < end && (*pos == '+' || *pos == '-')) negativeExp = *pos++ == '-';
+		const char *start = pos;
+		int e = 0;
+		for (; pos < end && inl_isdigit(*pos); pos++) {
+			if (e < 100000) e = e * 10 + (*pos - '0');
+		}
+		if (pos == start) found = false;
+		exponent += negativeExp ? -e : e;
+	}
+	
+	if (!found) {
+		v = 0.f;
+		failed = true;
+		return *this;
+	}
+	
+	/* Exact when both operands are exact doubles */
+	if (mantissa == 0) {
+		v = negative ? -0.f : 0.f;
+		return *this;
+	} else if (digits <= 19 && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+		double d = static_cast<double>(mantissa);
+		d = exponent < 0 ? d / pow10[-exponent] : d * pow10[exponent];
+		if (inl_floatsafe(d)) {
+			v = static_cast<float>(negative ? -d : d);
+			if (v == std::numeric_limits<float>::infinity()
+			|| v == -std::numeric_limits<float>::infinity()) {
+				failed = true;
+			}
+			return *this;
+		}
+	}
+	
+	if (!slow(begin, v)) failed = true;
+	return *this;
+}
+
+Scanner& Scanner::operator>>(int &v)
+{
+	if (!skip()) return *this;
+	bool negative = false;
+	if (pos < end && (*pos == '+' || *pos == '-')) negative = *pos++ == '-';
+	const char *start = pos;
+	long long value = 0;
+	for (; pos < end && inl_isdigit(*pos); pos++) {
+		if (value <= std::numeric_limits<int>::max()) value = value * 10 + (*pos - '0');
+	}
+	if (negative) value = -value;
+	if (pos == start) {
+		v = 0;
+		failed = true;
+	} else if (value > std::numeric_limits<int>::max()) {
+		v = std::numeric_limits<int>::max();
+		failed = true;
+	} else if (value < std::numeric_limits<int>::min()) {
+		v = std::numeric_limits<int>::min();
+		failed = true;
+	} else {
+		v = static_cast<int>(value);
+	}
+	return *this;
+}
+
+Scanner& Scanner::operator>>(Range &token)
+{
+	if (!skip()) return *this;
+	token.begin = pos;
+	while (pos < end && !inl_isspace(*pos)) pos++;
+	token.end = pos;
+	return *this;
+}
+
+int Scanner::peek() const
+{
+	if (failed || pos == end) return -1;
+	return static_cast<unsigned char>(*pos);
+}
+
+int Scanner::get()
+{
+	int c = peek();
+	if (c < 0) {
+		failed = true;
+	} else {
+		pos++;
+	}
+	return c;
+}
+
+bool Scanner::fail() const
+{
+	return failed;
+}
+
+void Scanner::setFail()
+{
+	failed = true;
+}
+
+void Scanner::clear()
+{
+	failed = false;
+}
+
+bool Scanner::skip()
+{
+	if (failed) return false;
+	while (pos < end && inl_isspace(*pos)) pos++;
+	if (pos == end) failed = true;
+	return !failed;
+}
+
+bool Scanner::slow(const char *begin, float &v)
+{
+	std::istringstream in(std::string(begin, pos));
+	in.imbue(std::locale::classic());
+	in >> v;
+	return !in.fail();
+}
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef _OBJ_SCANNER_HPP_
+#define _OBJ_SCANNER_HPP_
+
+#include "Range.hpp"
+
+namespace OBJ {
+	
+	
+	
+	/*
+		Locale independent number extraction from a range.
+		Accepts and rejects exactly what std::istream does in the "C" locale,
+		values are rounded like std::strtof.
+	*/
+	class Scanner {
+	public:
+		
+		Scanner(const Range &range);
+		
+		/* Extract a number, does nothing once failed */
+		Scanner& operator>>(float &v);
+		Scanner& operator>>(int &v);
+		
+		/* Extract a whitespace separated token */
+		Scanner& operator>>(Range &token);
+		
+		/* Next character or -1 */
+		int peek() const;
+		int get();
+		
+		/* Extraction state */
+		bool fail() const;
+		void setFail();
+		void clear();
+		
+	private:
+		
+		bool skip();
+		bool slow(const char *begin, float &v);
+		const char *pos;
+		const char *end;
+		bool failed;
+		
+	};
+	
+	
+	
+} // namespace OBJ
+
+#endif // _OBJ_SCANNER_HPP_
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef _OBJ_SMALLVECTOR_HPP_
+#define _OBJ_SMALLVECTOR_HPP_
+
+#include <vector>
+#include <cstddef> // std::size_t
+
+namespace OBJ {
+	
+	
+	
+	/* Vector storing up to N values inline, only larger sizes allocate */
+	template <typename T, std::size_t N>
+	class SmallVector {
+	public:
+		
+		SmallVector() : count(0) {}
+		
+		void push_back(const T &value) {
+			if (count < N) {
+				local[count] = value;
+			} else {
+				if (count == N) spill.assign(local, local + N);
+				spill.push_back(value);
+			}
+			count++;
+		}
+		
+		void clear() {
+			spill.clear();
+			count = 0;
+		}
+		
+		std::size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+		
+		T* data() { return count <= N ? local : spill.data(); }
+		const T* data() const { return count <= N ? local : spill.data(); }
+		
+		T& operator[](std::size_t i) { return data()[i]; }
+		const T& operator[](std::size_t i) const { return data()[i]; }
+		
+		T* begin() { return data(); }
+		T* end()   { return data() + count; }
+		const T* begin() const { return data(); }
+		const T* end()   const { return data() + count; }
+		
+	private:
+		
+		T local[N];
+		std::vector<T> spill;
+		std::size_t count;
+		
+	};
+	
+	
+	
+} // namespace OBJ
+
+#endif // _OBJ_SMALLVECTOR_HPP_
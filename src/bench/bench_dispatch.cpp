@@ -0,0 +1,159 @@
+#include "../Common/OBJ/Parser.hpp"
+#include "../Common/OBJ/Scanner.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <algorithm> // std::min
+#include <cstdlib> // std::atoi
+
+/*
+	Times OBJParser keyword dispatch per line against the comparison chain
+	it replaced. Both parsers extract records the same way and accept them
+	without storing anything, so they only differ in how a keyword finds
+	its handler. Usage: bench_dispatch [lines per keyword]
+*/
+
+/* Accepts every record and counts them */
+struct CountingParser : public OBJ::OBJParser {
+	std::size_t records = 0;
+	bool parse(OBJ::Vertex::Geometry&)             override { records++; return true; }
+	bool parse(OBJ::Vertex::Texture&)              override { records++; return true; }
+	bool parse(OBJ::Vertex::Normal&)               override { records++; return true; }
+	bool parse(OBJ::Element::Point&)               override { records++; return true; }
+	bool parse(OBJ::Element::Line&)                override { records++; return true; }
+	bool parse(OBJ::Element::Face&)                override { records++; return true; }
+	bool parse(OBJ::Grouping::Groups&)             override { records++; return true; }
+	bool parse(OBJ::Grouping::Smoothing&)          override { records++; return true; }
+	bool parse(OBJ::Grouping::Merge&)              override { records++; return true; }
+	bool parse(OBJ::Grouping::Object&)             override { records++; return true; }
+	bool parse(OBJ::Render::Bevel&)                override { records++; return true; }
+	bool parse(OBJ::Render::ColorInterpolation&)   override { records++; return true; }
+	bool parse(OBJ::Render::DissolveInterpolation&) override { records++; return true; }
+	bool parse(OBJ::Render::LevelOfDetail&)        override { records++; return true; }
+	bool parse(OBJ::Render::UseMaterial&)          override { records++; return true; }
+	bool parse(OBJ::Render::MaterialLib&)          override { records++; return true; }
+	bool parse(OBJ::Render::ShadowObject&)         override { records++; return true; }
+	bool parse(OBJ::Render::TraceObject&)          override { records++; return true; }
+	bool custom(const OBJ::Range&, const OBJ::Range&) override { records++; return true; }
+};
+
+/* The keyword chain OBJParser used before, one comparison per keyword in turn */
+struct ChainParser : public CountingParser {
+	
+	template<typename T>
+	bool scanner(const OBJ::Range &args) {
+		OBJ::Scanner in(args);
+		T obj;
+		in >> obj;
+		if (in.fail()) return false;
+		return parse(obj);
+	}
+	
+	template<typename T>
+	bool parser(const OBJ::Range &args) {
+		std::istream &in = stream(args);
+		T obj;
+		in >> obj;
+		if (in.fail()) return false;
+		flush();
+		return parse(obj);
+	}
+	
+	bool token(const OBJ::Range &t, const OBJ::Range &args) override {
+		if (t.equals("v"))          return scanner<OBJ::Vertex::Geometry>(args);
+		if (t.equals("vn"))         return scanner<OBJ::Vertex::Normal>(args);
+		if (t.equals("vt"))         return scanner<OBJ::Vertex::Texture>(args);
+		if (t.equals("p"))          return scanner<OBJ::Element::Point>(args);
+		if (t.equals("l"))          return scanner<OBJ::Element::Line>(args);
+		if (t.equals("f"))          return scanner<OBJ::Element::Face>(args);
+		if (t.equals("g"))          return parser<OBJ::Grouping::Groups>(args);
+		if (t.equals("s"))          return parser<OBJ::Grouping::Smoothing>(args);
+		if (t.equals("mg"))         return parser<OBJ::Grouping::Merge>(args);
+		if (t.equals("o"))          return parser<OBJ::Grouping::Object>(args);
+		if (t.equals("bevel"))      return parser<OBJ::Render::Bevel>(args);
+		if (t.equals("c_interp"))   return parser<OBJ::Render::ColorInterpolation>(args);
+		if (t.equals("d_interp"))   return parser<OBJ::Render::DissolveInterpolation>(args);
+		if (t.equals("lod"))        return parser<OBJ::Render::LevelOfDetail>(args);
+		if (t.equals("usemtl"))     return parser<OBJ::Render::UseMaterial>(args);
+		if (t.equals("mtllib"))     return parser<OBJ::Render::MaterialLib>(args);
+		if (t.equals("shadow_obj")) return parser<OBJ::Render::ShadowObject>(args);
+		if (t.equals("trace_obj"))  return parser<OBJ::Render::TraceObject>(args);
+		flush();
+		return custom(t, args);
+	}
+	
+};
+
+/* Nanoseconds per line, fails if a line wasn't accepted */
+double timeLines(CountingParser &parser, const std::string &text, std::size_t lines, std::ostream &sink) {
+	parser.records = 0;
+	auto start = std::chrono::steady_clock::now();
+	parser.read(OBJ::Range(text), sink);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (parser.records != lines) return -1.0;
+	return seconds * 1e9 / lines;
+}
+
+int main(int argc, char* args[]) {
+	
+	std::size_t lines = argc > 1 ? std::atoi(args[1]) : 200000;
+	if (lines == 0) lines = 1;
+	
+	/* Each keyword with small valid arguments, vp isn't in the table.
+	 * Lines that fail to parse are logged to a string and fail the benchmark. */
+	static const char *records[][2] = {
+		{ "v",          "1.5 2.5 3.5" },
+		{ "vt",         "0.25 0.75" },
+		{ "vn",         "0 0 1" },
+		{ "p",          "1" },
+		{ "l",          "1 2" },
+		{ "f",          "1/1/1 2/2/2 3/3/3" },
+		{ "g",          "group" },
+		{ "s",          "1" },
+		{ "mg",         "1 2" },
+		{ "o",          "object" },
+		{ "bevel",      "on" },
+		{ "c_interp",   "off" },
+		{ "d_interp",   "off" },
+		{ "lod",        "1" },
+		{ "usemtl",     "material" },
+		{ "mtllib",     "file.mtl" },
+		{ "shadow_obj", "shadow.obj" },
+		{ "trace_obj",  "trace.obj" },
+		{ "vp",         "0.5" }
+	};
+	
+	std::ostringstream sink;
+	CountingParser table;
+	ChainParser    chain;
+	double totalTable = 0.0, totalChain = 0.0;
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << std::setw(12) << "keyword" << std::setw(10) << "chain" << std::setw(10) << "table" << "  ns per line" << std::endl;
+	for (const auto &record : records) {
+		std::string line = std::string(record[0]) + " " + record[1] + "\n";
+		std::string text;
+		text.reserve(line.size() * lines);
+		for (std::size_t i = 0; i < lines; i++) text += line;
+		
+		/* Best of alternating runs */
+		double nsChain = 0.0, nsTable = 0.0;
+		for (int run = 0; run < 3; run++) {
+			double a = timeLines(chain, text, lines, sink);
+			double b = timeLines(table, text, lines, sink);
+			if (a < 0.0 || b < 0.0) {
+				std::cerr << "Error: " << record[0] << " lines weren't all accepted" << std::endl;
+				return -1;
+			}
+			nsChain = run == 0 ? a : std::min(nsChain, a);
+			nsTable = run == 0 ? b : std::min(nsTable, b);
+		}
+		totalChain += nsChain;
+		totalTable += nsTable;
+		std::cout << std::setw(12) << record[0] << std::setw(10) << nsChain << std::setw(10) << nsTable << std::endl;
+	}
+	double count = sizeof(records) / sizeof(records[0]);
+	std::cout << std::setw(12) << "mean" << std::setw(10) << totalChain / count << std::setw(10) << totalTable / count << std::endl;
+	return 0;
+}
@@ -0,0 +1,249 @@
+#include "../Common/CFR/Geometry.hpp"
+#include <glm/gtc/packing.hpp>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <cstring> // std::memcpy
+#include <cstdlib> // std::atoi
+#include <cstdint> // std::int8_t, std::int16_t
+
+/*
+	Times saving a geometry with operator<< against the per-field writer it
+	replaced, which is carried here. Both write a version 1 file of the same
+	geometry into memory and must give the same bytes. The old writer only
+	knows the plain attribute types and no meshlets.
+	Usage: bench_save [file.cfrg] [repeats]
+	Without a file, a grid with the default attribute types is generated.
+*/
+
+using namespace CFR;
+
+/* The writer before bulk blocks, a stream put per byte and a type switch per component */
+namespace Old {
+	
+	inline void write8(std::ostream &out, uint8_t v) {
+		out.put(v);
+	}
+	inline void write16(std::ostream &out, uint16_t v) {
+		write8(out, static_cast<uint8_t>((v >> 0) & 0xFF));
+		write8(out, static_cast<uint8_t>((v >> 8) & 0xFF));
+	}
+	inline void write32(std::ostream &out, uint32_t v) {
+		write8(out, static_cast<uint8_t>((v >> 0 ) & 0xFF));
+		write8(out, static_cast<uint8_t>((v >> 8 ) & 0xFF));
+		write8(out, static_cast<uint8_t>((v >> 16) & 0xFF));
+		write8(out, static_cast<uint8_t>((v >> 24) & 0xFF));
+	}
+	
+	inline Uint32 packFull(float v) { Uint32 u; std::memcpy(&u, &v, 4); return u; }
+	inline Uint16 packHalf(float v) { return glm::packHalf1x16 (v); }
+	inline Uint16 packNormSShort(float v) { return glm::packSnorm1x16(v); }
+	inline Uint16 packNormUShort(float v) { return glm::packUnorm1x16(v); }
+	inline Uint8  packNormSByte (float v) { return glm::packSnorm1x8 (v); }
+	inline Uint8  packNormUByte (float v) { return glm::packUnorm1x8 (v); }
+	inline Uint16 packSShort(float v) { return static_cast<std::int16_t>(glm::round(glm::clamp(v, -32767.f, 32767.f))); }
+	inline Uint16 packUShort(float v) { return static_cast<Uint16>(glm::round(glm::clamp(v, +0.f,     65535.f))); }
+	inline Uint8  packSByte (float v) { return static_cast<std::int8_t >(glm::round(glm::clamp(v, -127.f,   127.f  ))); }
+	inline Uint8  packUByte (float v) { return static_cast<Uint8 >(glm::round(glm::clamp(v, +0.f,     255.f  ))); }
+	
+	inline Uint8 typeGetSize(Uint8 type) {
+		switch (type) {
+		case TYPE_FLOAT:                                                return 4;
+		case TYPE_HALF_FLOAT: case TYPE_SHORT: case TYPE_UNSIGNED_SHORT:
+		case TYPE_NORM_SHORT: case TYPE_NORM_UNSIGNED_SHORT:            return 2;
+		case TYPE_BYTE: case TYPE_UNSIGNED_BYTE:
+		case TYPE_NORM_BYTE: case TYPE_NORM_UNSIGNED_BYTE:              return 1;
+		default:                                                        return 0;
+		}
+	}
+	
+	inline void writeFloat(std::ostream &out, float v, Uint8 type) {
+		switch (type) {
+		case TYPE_FLOAT:               write32(out, packFull      (v)); break;
+		case TYPE_HALF_FLOAT:          write16(out, packHalf      (v)); break;
+		case TYPE_SHORT:               write16(out, packSShort    (v)); break;
+		case TYPE_UNSIGNED_SHORT:      write16(out, packUShort    (v)); break;
+		case TYPE_BYTE:                write8 (out, packSByte     (v)); break;
+		case TYPE_UNSIGNED_BYTE:       write8 (out, packUByte     (v)); break;
+		case TYPE_NORM_SHORT:          write16(out, packNormSShort(v)); break;
+		case TYPE_NORM_UNSIGNED_SHORT: write16(out, packNormUShort(v)); break;
+		case TYPE_NORM_BYTE:           write8 (out, packNormSByte (v)); break;
+		case TYPE_NORM_UNSIGNED_BYTE:  write8 (out, packNormUByte (v)); break;
+		}
+	}
+	
+	void save(std::ostream &out, const Geometry &obj) {
+		Uint8 typePosition = obj.getTypePosition();
+		Uint8 typeTexcoord = obj.getTypeTexcoord();
+		Uint8 typeNormal   = obj.getTypeNormal();
+		Uint8 typeTangent  = obj.getTypeTangent();
+		
+		Uint8 sizePosition = 3 * typeGetSize(typePosition);
+		Uint8 sizeTexcoord = 2 * typeGetSize(typeTexcoord);
+		Uint8 sizeNormal   = 3 * typeGetSize(typeNormal);
+		Uint8 sizeTangent  = 4 * typeGetSize(typeTangent);
+		
+		Uint8 offsetPosition = 0;
+		Uint8 offsetTexcoord = offsetPosition + sizePosition;
+		Uint8 offsetNormal   = offsetTexcoord + sizeTexcoord;
+		Uint8 offsetTangent  = offsetNormal   + sizeNormal;
+		
+		Uint32 countElements   = obj.getElementCount();
+		Uint32 countVertices   = obj.getVertexCount();
+		Uint8  bytesPerVertex =
+			sizePosition + sizeTexcoord +
+			sizeNormal   + sizeTangent;
+		Uint8  bytesPerElement = 4;
+		
+		if (obj.getElementMax() <= 0xFF )  bytesPerElement = 1;
+		if (obj.getElementMax() <= 0xFFFF) bytesPerElement = 2;
+		
+		write32(out, 0x47524643);
+		write32(out, 1);
+		write32(out, countElements);
+		write32(out, countVertices);
+		write8 (out, bytesPerVertex);
+		write8 (out, bytesPerElement);
+		
+		write8 (out, offsetPosition);
+		write8 (out, typePosition);
+		write8 (out, offsetTexcoord);
+		write8 (out, typeTexcoord);
+		write8 (out, offsetNormal);
+		write8 (out, typeNormal);
+		write8 (out, offsetTangent);
+		write8 (out, typeTangent);
+		for (int i = 0; i < 6; i++) write8 (out, 0);
+		
+		size_type vertexCount = obj.getVertexCount();
+		for (size_type i = 0; i < vertexCount; i++) {
+			const Vertex& vertex = obj.getVertex(i);
+			writeFloat(out, vertex.position.x, typePosition);
+			writeFloat(out, vertex.position.y, typePosition);
+			writeFloat(out, vertex.position.z, typePosition);
+			writeFloat(out, vertex.texcoord.x, typeTexcoord);
+			writeFloat(out, vertex.texcoord.y, typeTexcoord);
+			writeFloat(out, vertex.normal.x,   typeNormal);
+			writeFloat(out, vertex.normal.y,   typeNormal);
+			writeFloat(out, vertex.normal.z,   typeNormal);
+			writeFloat(out, vertex.tangent.x,  typeTangent);
+			writeFloat(out, vertex.tangent.y,  typeTangent);
+			writeFloat(out, vertex.tangent.z,  typeTangent);
+			writeFloat(out, vertex.tangent.w,  typeTangent);
+		}
+		
+		size_type elementCount = obj.getElementCount();
+		switch (bytesPerElement) {
+		case 1:
+			for (size_type i = 0; i < elementCount; i++) {
+				write8(out, obj.getElement(i));
+			}
+			break;
+		case 2:
+			for (size_type i = 0; i < elementCount; i++) {
+				write16(out, obj.getElement(i));
+			}
+			break;
+		case 4:
+			for (size_type i = 0; i < elementCount; i++) {
+				write32(out, obj.getElement(i));
+			}
+			break;
+		}
+	}
+	
+	bool supports(const Geometry &obj) {
+		Uint8 types[4] = { obj.getTypePosition(), obj.getTypeTexcoord(), obj.getTypeNormal(), obj.getTypeTangent() };
+		for (Uint8 type : types) {
+			if (type != TYPE_DISABLE && typeGetSize(type) == 0) return false;
+		}
+		return obj.getMeshletCount() == 0;
+	}
+	
+} // namespace Old
+
+/* Grid of size x size quads with a normal and tangent per vertex */
+void generate(Geometry &obj, Uint32 size) {
+	for (Uint32 y = 0; y <= size; y++) {
+		for (Uint32 x = 0; x <= size; x++) {
+			Vertex v;
+			v.position.x = float(x);
+			v.position.y = 0.1f * float((x * 7 + y * 13) % 17);
+			v.position.z = float(y);
+			v.texcoord.x = float(x) / size;
+			v.texcoord.y = float(y) / size;
+			v.normal.y  = 1.f;
+			v.tangent.x = 1.f;
+			v.tangent.w = 1.f;
+			obj.pushVertex(v);
+		}
+	}
+	for (Uint32 y = 0; y < size; y++) {
+		for (Uint32 x = 0; x < size; x++) {
+			Uint32 a = y * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+			obj.addElement(a); obj.addElement(c); obj.addElement(b);
+			obj.addElement(b); obj.addElement(c); obj.addElement(d);
+		}
+	}
+}
+
+/* Seconds of the best run, the output of the last run is kept */
+template<typename Save>
+double timeSave(Save save, std::string &output, int repeats) {
+	double best = 0.0;
+	for (int n = 0; n < repeats; n++) {
+		std::ostringstream out(std::ios::out | std::ios::binary);
+		auto start = std::chrono::steady_clock::now();
+		save(out);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		best = n == 0 ? seconds : std::min(best, seconds);
+		output = out.str();
+	}
+	return best;
+}
+
+int main(int argc, char* args[]) {
+	
+	Geometry geometry;
+	int repeats = argc > 2 ? std::atoi(args[2]) : 5;
+	try {
+		if (argc > 1) {
+			geometry.loadFromFile(args[1]);
+		} else {
+			generate(geometry, 700);
+		}
+	} catch (const std::exception &e) {
+		std::cerr << "Error: " << e.what() << std::endl;
+		return -1;
+	}
+	geometry.setFileVersion(1);
+	if (!Old::supports(geometry)) {
+		std::cerr << "Error: The old writer doesn't support this geometry's types or meshlets" << std::endl;
+		return -1;
+	}
+	if (repeats < 1) repeats = 1;
+	
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << geometry.getVertexCount() << " vertices, " << geometry.getElementCount() << " elements, " << repeats << " repeats" << std::endl;
+	
+	/* Both vertex storages, packed vertices are decoded by getVertex() */
+	VertexStorage storages[2] = { STORAGE_FULL, STORAGE_PACKED };
+	const char *names[2] = { "full", "packed" };
+	for (int s = 0; s < 2; s++) {
+		geometry.setVertexStorage(storages[s]);
+		std::string oldBytes, newBytes;
+		double oldSeconds = timeSave([&](std::ostream &out) { Old::save(out, geometry); }, oldBytes, repeats);
+		double newSeconds = timeSave([&](std::ostream &out) { out << geometry; }, newBytes, repeats);
+		double mb = newBytes.size() / 1048576.0;
+		std::cout << names[s] << " storage, " << mb << " MB" << std::endl;
+		std::cout << "  per field " << mb / oldSeconds << " MB/s" << std::endl;
+		std::cout << "  bulk      " << mb / newSeconds << " MB/s, " << oldSeconds / newSeconds << "x" << std::endl;
+		if (oldBytes != newBytes) {
+			std::cerr << "Error: The writers give different files" << std::endl;
+			return -1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,137 @@
+#include "../Common/OBJ/Objects.hpp"
+#include "../Common/OBJ/Range.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <cstring> // std::memcmp
+#include <cstdlib> // std::atoi
+
+/*
+	Times OBJ::Scanner against the std::istream extractors on the arguments
+	of v, vt and vn lines. The istream is reused over a RangeBuffer, like
+	TokenParser::stream(). Usage: bench_scanner [file.obj] [repeats]
+	Without a file, random records in the usual %.6f style are generated.
+*/
+
+struct Records {
+	std::string text;
+	std::vector<OBJ::Range> v, vt, vn; // Arguments after the keyword
+	std::size_t bytes = 0;
+};
+
+/* Split v, vt and vn lines into keyword arguments, other lines are skipped */
+void split(Records &r) {
+	const char *pos = r.text.data(), *end = pos + r.text.size();
+	std::vector<std::pair<std::size_t, std::size_t>> args[3];
+	while (pos < end) {
+		const char *line = pos;
+		while (pos < end && *pos != '\n') pos++;
+		const char *lineEnd = pos++;
+		const char *space = line;
+		while (space < lineEnd && *space != ' ' && *space != '\t') space++;
+		int kind = -1;
+		if      (space - line == 1 && line[0] == 'v') kind = 0;
+		else if (space - line == 2 && line[0] == 'v' && line[1] == 't') kind = 1;
+		else if (space - line == 2 && line[0] == 'v' && line[1] == 'n') kind = 2;
+		if (kind < 0) continue;
+		args[kind].emplace_back(space - r.text.data(), lineEnd - r.text.data());
+		r.bytes += lineEnd - space;
+	}
+	std::vector<OBJ::Range>* out[3] = { &r.v, &r.vt, &r.vn };
+	for (int k = 0; k < 3; k++) {
+		for (auto &a : args[k]) out[k]->emplace_back(r.text.data() + a.first, r.text.data() + a.second);
+	}
+}
+
+void generate(Records &r, std::size_t lines) {
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> position(-100.f, 100.f), unit(-1.f, 1.f), texcoord(0.f, 1.f);
+	std::ostringstream os;
+	os << std::fixed << std::setprecision(6);
+	for (std::size_t i = 0; i < lines; i++) {
+		os << "v "  << position(rng) << " " << position(rng) << " " << position(rng) << "\n";
+		os << "vt " << texcoord(rng) << " " << texcoord(rng) << "\n";
+		os << "vn " << unit(rng)     << " " << unit(rng)     << " " << unit(rng)     << "\n";
+	}
+	r.text = os.str();
+}
+
+template<typename T>
+double timeStream(const std::vector<OBJ::Range> &args, std::vector<T> &out, int repeats) {
+	OBJ::RangeBuffer buffer;
+	std::istream in(&buffer);
+	auto start = std::chrono::steady_clock::now();
+	for (int n = 0; n < repeats; n++) {
+		for (std::size_t i = 0; i < args.size(); i++) {
+			buffer.reset(args[i]);
+			in.clear();
+			in >> out[i];
+		}
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template<typename T>
+double timeScanner(const std::vector<OBJ::Range> &args, std::vector<T> &out, int repeats) {
+	auto start = std::chrono::steady_clock::now();
+	for (int n = 0; n < repeats; n++) {
+		for (std::size_t i = 0; i < args.size(); i++) {
+			OBJ::Scanner in(args[i]);
+			in >> out[i];
+		}
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/* Both extractors must give the same bits */
+template<typename T>
+std::size_t mismatches(const std::vector<T> &a, const std::vector<T> &b) {
+	std::size_t count = 0;
+	for (std::size_t i = 0; i < a.size(); i++) count += std::memcmp(&a[i], &b[i], sizeof(T)) != 0;
+	return count;
+}
+
+int main(int argc, char* args[]) {
+	
+	Records r;
+	int repeats = argc > 2 ? std::atoi(args[2]) : 5;
+	if (argc > 1) {
+		std::ifstream file(args[1], std::ios::in | std::ios::binary);
+		if (!file.is_open()) {
+			std::cerr << "Error: Failed to open " << args[1] << std::endl;
+			return -1;
+		}
+		std::ostringstream os;
+		os << file.rdbuf();
+		r.text = os.str();
+	} else {
+		generate(r, 200000);
+	}
+	split(r);
+	if (repeats < 1) repeats = 1;
+	
+	std::vector<OBJ::Vertex::Geometry> vStream(r.v.size()),  vScan(r.v.size());
+	std::vector<OBJ::Vertex::Texture>  tStream(r.vt.size()), tScan(r.vt.size());
+	std::vector<OBJ::Vertex::Normal>   nStream(r.vn.size()), nScan(r.vn.size());
+	
+	double stream = timeStream(r.v, vStream, repeats) + timeStream(r.vt, tStream, repeats) + timeStream(r.vn, nStream, repeats);
+	double scan = timeScanner(r.v, vScan, repeats) + timeScanner(r.vt, tScan, repeats) + timeScanner(r.vn, nScan, repeats);
+	std::size_t wrong = mismatches(vStream, vScan) + mismatches(tStream, tScan) + mismatches(nStream, nScan);
+	
+	double mb = double(r.bytes) * repeats / 1048576.0;
+	std::size_t records = r.v.size() + r.vt.size() + r.vn.size();
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << records << " records, " << r.bytes / 1048576.0 << " MB of arguments, " << repeats << " repeats" << std::endl;
+	std::cout << "std::istream " << mb / stream << " MB/s" << std::endl;
+	std::cout << "OBJ::Scanner " << mb / scan   << " MB/s, " << stream / scan << "x" << std::endl;
+	if (wrong > 0) {
+		std::cerr << "Error: " << wrong << " records differ" << std::endl;
+		return -1;
+	}
+	return 0;
+}
@@ -2,49 +2,122 @@
 #include <iostream>
 #include <iomanip>
 #include <ctime>
+#include <thread>
+#include <memory>
+#include <cstdlib>
 #include <glm/glm.hpp>
 
+/* Element of a v/vt/vn corner, entries of the same v are chained.
+ * Only used while tangents are disabled, which by default happens for files without texture coordinates. */
+struct IndexEntry {
+	std::size_t vt, vn;
+	CFR::Uint32 element;
+	CFR::Uint32 next;
+};
+
 struct Converter : public OBJ::ElementReader {
 	
 	CFR::Geometry &geometry;
 	CFR::Model    &model;
+	CFR::GeometryBuilder *builder = nullptr;
 	std::time_t lastReport = 0;
-	std::size_t lines      = 0;
 	OBJ::MaterialSaver materials;
 	OBJ::Material      material;
 	CFR::size_type     lastElements = 0;
 	std::string        lastMaterial;
+	std::vector<CFR::Uint32> indexFirst;
+	std::vector<IndexEntry>  indexEntries;
 	
 	Converter(CFR::Geometry &geometry, CFR::Model &model);
-	bool parse(OBJ::Vertex::Geometry& v) override;
 	bool parse(OBJ::Grouping::Groups& g) override;
 	bool parse(OBJ::Grouping::Smoothing& g) override;
 	bool parse(OBJ::Render::UseMaterial& r) override;
 	bool parse(OBJ::Render::MaterialLib& r) override;
 	bool parse(OBJ::Triangle &t) override;
+	void triangles(const OBJ::TriangleIndex *t, std::size_t count) override;
+	bool indexed(const OBJ::TriangleIndex &t) const;
+	CFR::Uint32 addIndexed(const OBJ::VertexIndex &i, bool hasUV);
 	void done() override;
+	void progress(std::size_t bytes, std::size_t total) override;
 	void report(bool force);
 	void addNormal(OBJ::TriangleVertex &a, const OBJ::TriangleVertex &b, const OBJ::TriangleVertex &c);
 	void addTangent(CFR::Vertex &v, const CFR::Vertex &b, const CFR::Vertex &c);
+	CFR::Uint32 addVertex(const CFR::Vertex &v);
+	void addElement(CFR::Uint32 element);
+	CFR::size_type getElementCount() const;
+	CFR::size_type getVertexCount() const;
 };
 
+void optimizeObjects(CFR::Geometry &geometry, const CFR::Model &model);
+void optimizeVertices(CFR::Geometry &geometry);
+void buildMeshlets(CFR::Geometry &geometry, const CFR::Model &model);
+void buildLods(CFR::Geometry &geometry, CFR::Model &model, bool optimizeCache);
+
 int main(int argc, char* args[]) {
 	
 	/* Check arguments */
-	if (argc <= 1) {
+	std::string fileInput;
+	bool optimizeCache = false;
+	bool optimizeFetch = false;
+	bool meshlets      = false;
+	bool lods          = false;
+	bool packed        = false;
+	bool external      = false;
+	bool compress      = false;
+	bool octahedral    = false;
+	bool qtangent      = false;
+	bool quantize      = false;
+	CFR::size_type memoryBudget = 256;
+	for (int i = 1; i < argc; i++) {
+		std::string arg(args[i]);
+		if (arg == "--optimize-cache") {
+			optimizeCache = true;
+		} else if (arg == "--optimize-fetch") {
+			optimizeFetch = true;
+		} else if (arg == "--meshlets") {
+			meshlets = true;
+		} else if (arg == "--lod") {
+			lods = true;
+		} else if (arg == "--packed") {
+			packed = true;
+		} else if (arg == "--external") {
+			external = true;
+		} else if (arg == "--compress") {
+			compress = true;
+		} else if (arg == "--octahedral") {
+			octahedral = true;
+		} else if (arg == "--qtangent") {
+			qtangent = true;
+		} else if (arg == "--quantize") {
+			quantize = true;
+		} else if (arg == "--memory" && i + 1 < argc) {
+			memoryBudget = std::strtoul(args[++i], nullptr, 10);
+		} else if (arg.compare(0, 2, "--") == 0) {
+			std::cerr << "Error: Unknown option " << arg << std::endl;
+			std::cin.get();
+			return -1;
+		} else {
+			fileInput = arg;
+		}
+	}
+	if (fileInput.empty()) {
 		std::cerr << "Error: No input files." << std::endl;
 		std::cin.get();
 		return -1;
 	}
+	if (external && (optimizeCache || optimizeFetch || meshlets || lods || packed || compress || quantize)) {
+		std::cerr << "Error: --external only writes the geometry, other options need it in memory." << std::endl;
+		std::cin.get();
+		return -1;
+	} else if (memoryBudget == 0) {
+		std::cerr << "Error: Invalid memory budget." << std::endl;
+		std::cin.get();
+		return -1;
+	}
 	
 	/* Output files */
-	std::string fileModel    = getPrefix(args[1], '.') + ".cfrm";
-	std::string fileGeometry = getPrefix(args[1], '.') + ".cfrg";
-	
-	/* Find number of lines */
-	std::cout << "Counting lines." << std::endl;
-	std::size_t lines = countFileLines(args[1]);
-	std::cout << "Total lines: " << lines << std::endl;
+	std::string fileModel    = getPrefix(fileInput, '.') + ".cfrm";
+	std::string fileGeometry = getPrefix(fileInput, '.') + ".cfrg";
 	
 	/* Set float precision */
 	std::cout << std::fixed << std::setprecision(2);
@@ -55,20 +128,76 @@ int main(int argc, char* args[]) {
 	geometry.setTypeTexcoord(CFR::TYPE_HALF_FLOAT);
 	geometry.setTypeNormal  (CFR::TYPE_HALF_FLOAT);
 	geometry.setTypeTangent (CFR::TYPE_HALF_FLOAT);
+	if (octahedral) geometry.setTypeNormal(CFR::TYPE_OCT_NORM_SHORT);
+	if (qtangent) {
+		geometry.setTypeNormal (CFR::TYPE_DISABLE);
+		geometry.setTypeTangent(CFR::TYPE_QTANGENT_NORM_SHORT);
+	}
+	if (octahedral || qtangent) {
+		std::cout << "Encoded normals, " << geometry.getVertexSize() << " bytes per vertex" << std::endl;
+	}
+	if (packed) {
+		geometry.setVertexStorage(CFR::STORAGE_PACKED);
+		std::cout << "Packed vertex storage, " << geometry.getVertexSize() << " bytes per vertex instead of " << sizeof(CFR::Vertex) << std::endl;
+	}
+	if (compress) geometry.setFileVersion(2);
 	
 	/* Model */
 	CFR::Model model(removePath(fileGeometry));
-	model.setHeader("CFR Model generated from " + to_string(removePath(args[1])));
+	model.setHeader("CFR Model generated from " + to_string(removePath(fileInput)));
+	
+	/* Out-of-core geometry */
+	std::unique_ptr<CFR::GeometryBuilder> builder;
+	if (external) {
+		try {
+			builder.reset(new CFR::GeometryBuilder(geometry, fileGeometry, memoryBudget << 20));
+		} catch (CFR::Exception &fail) {
+			std::cerr << "Error creating geometry: " << fail.what() << std::endl;
+			std::cin.get();
+			return -1;
+		}
+		std::cout << "Out-of-core geometry, " << memoryBudget << " MB sort budget" << std::endl;
+	}
 	
 	/* Read obj file */
 	Converter c(geometry, model);
-	c.lines = lines;
-	c.read(args[1], std::cout);
+	c.builder = builder.get();
+	c.setReadMode(OBJ::READ_MAPPED);
+	c.setThreads(std::thread::hardware_concurrency());
+	c.setTriangleBatch(OBJ::BATCH_INDICES);
+	c.read(fileInput, std::cout);
+	
+	/* Quantize positions within the mesh bounds */
+	if (quantize) {
+		geometry.fitBounds();
+		geometry.setTypePosition(CFR::TYPE_BOUNDS_NORM_UNSIGNED_SHORT);
+		std::cout << "Quantized positions, error at most " << std::setprecision(6) << geometry.getPositionError()
+		          << std::setprecision(2) << " units" << std::endl;
+	}
+	
+	/* Reorder triangles of each object */
+	if (optimizeCache) optimizeObjects(geometry, model);
+	
+	/* Append simplified levels of each object */
+	if (lods) buildLods(geometry, model, optimizeCache);
+	
+	/* Reorder vertices by their use */
+	if (optimizeFetch) optimizeVertices(geometry);
+	
+	/* Split objects into meshlets */
+	if (meshlets) buildMeshlets(geometry, model);
 	
 	/* Save geometry */
 	try {
 		std::cout << "Saving geometry to " << removePath(fileGeometry) << std::endl;
-		geometry.saveToFile(fileGeometry);
+		if (builder) {
+			builder->finish();
+			std::cout << builder->getUniqueCount() << " of " << builder->getVertexCount() << " vertices unique, ";
+			std::cout << builder->getRunCount() << " sorted runs spilled" << std::endl;
+			std::cout << "Peak memory " << getPeakMemory() / 1048576.f << " MB" << std::endl;
+		} else {
+			geometry.saveToFile(fileGeometry);
+		}
 	} catch (CFR::Exception &fail) {
 		std::cerr << "Error saving geometry: " << fail.what() << std::endl;
 		std::cin.get();
@@ -86,13 +215,112 @@ int main(int argc, char* args[]) {
 	return 0;
 }
 
+void optimizeObjects(CFR::Geometry &geometry, const CFR::Model &model) {
+	std::cout << "Optimizing vertex cache of " << model.getObjectCount() << " objects" << std::endl;
+	CFR::CacheStats before, after;
+	for (CFR::size_type i = 0; i < model.getObjectCount(); i++) {
+		const CFR::ModelObject &object = model.getObject(i);
+		before += CFR::getCacheStats(geometry, object.start, object.end);
+		CFR::optimizeVertexCache(geometry, object.start, object.end);
+		after  += CFR::getCacheStats(geometry, object.start, object.end);
+	}
+	std::cout << "ACMR " << before.getACMR() << " -> " << after.getACMR();
+	std::cout << " ATVR " << before.getATVR() << " -> " << after.getATVR() << std::endl;
+}
+
+void optimizeVertices(CFR::Geometry &geometry) {
+	std::cout << "Optimizing vertex fetch of " << geometry.getVertexCount() << " vertices" << std::endl;
+	CFR::size_type size = geometry.getVertexSize();
+	CFR::FetchStats before = CFR::getFetchStats(geometry, 0, geometry.getElementCount(), size);
+	geometry.reorderVertices();
+	CFR::FetchStats after  = CFR::getFetchStats(geometry, 0, geometry.getElementCount(), size);
+	std::cout << "Cache misses " << before.misses << " -> " << after.misses;
+	std::cout << " Overfetch " << before.getOverfetch() << " -> " << after.getOverfetch() << std::endl;
+}
+
+void buildLods(CFR::Geometry &geometry, CFR::Model &model, bool optimizeCache) {
+	static const float ratios[] = { 0.5f, 0.25f, 0.125f, 0.0625f };
+	static const std::size_t levels = sizeof(ratios) / sizeof(ratios[0]);
+	std::cout << "Simplifying " << model.getObjectCount() << " objects" << std::endl;
+	CFR::size_type triangles[levels + 1] = {};
+	float error[levels] = {};
+	std::vector<CFR::Uint32> result;
+	for (CFR::size_type i = 0; i < model.getObjectCount(); i++) {
+		CFR::ModelObject &object = model.getObject(i);
+		CFR::size_type start = object.start, end = object.end;
+		triangles[0] += (end - start) / 3;
+		
+		/* Each level simplifies the previous one, stop once nothing collapses */
+		std::size_t l = 0;
+		for (; l < levels; l++) {
+			CFR::size_type target = static_cast<CFR::size_type>((object.end - object.start) / 3 * ratios[l]);
+			float e = CFR::simplify(geometry, start, end, target, result);
+			if (result.size() == end - start) break;
+			CFR::ModelLod lod;
+			lod.start = geometry.getElementCount();
+			for (std::size_t j = 0; j < result.size(); j++) geometry.addElement(result[j]);
+			lod.end   = geometry.getElementCount();
+			lod.error = object.lods.empty() ? e : std::max(e, object.lods.back().error);
+			if (optimizeCache) CFR::optimizeVertexCache(geometry, lod.start, lod.end);
+			object.lods.push_back(lod);
+			triangles[l + 1] += (lod.end - lod.start) / 3;
+			error[l] = std::max(error[l], lod.error);
+			start = lod.start;
+			end   = lod.end;
+		}
+		for (; l < levels; l++) triangles[l + 1] += (end - start) / 3;
+		
+	}
+	for (std::size_t l = 0; l < levels; l++) {
+		std::cout << "LOD " << (l + 1) << " " << triangles[l + 1] << " of " << triangles[0] << " triangles";
+		std::cout << " error " << std::setprecision(6) << error[l] << std::setprecision(2) << std::endl;
+	}
+}
+
 CFR::Vec3 createVec3(float x, float y, float z) { CFR::Vec3 vec; vec.x = x; vec.y = y; vec.z = z; return vec; }
 CFR::Vec2 createVec2(float x, float y) { CFR::Vec2 vec; vec.x = x; vec.y = y; return vec; }
 
+void buildMeshlets(CFR::Geometry &geometry, const CFR::Model &model) {
+	std::cout << "Building meshlets" << std::endl;
+	CFR::size_type count = 0;
+	for (CFR::size_type i = 0; i < model.getObjectCount(); i++) {
+		count += CFR::buildMeshlets(geometry, model.getObject(i).start, model.getObject(i).end);
+	}
+	
+	/* Check cones from cameras around each meshlet, culled views must not see any triangle */
+	CFR::size_type views = 0, culled = 0, wrong = 0;
+	for (CFR::size_type i = 0; i < count; i++) {
+		const CFR::Meshlet &m = geometry.getMeshlet(i);
+		glm::vec3 center(m.center.x, m.center.y, m.center.z);
+		for (int d = 0; d < 27; d++) {
+			if (d == 13) continue;
+			glm::vec3 direction(d % 3 - 1.f, (d / 3) % 3 - 1.f, d / 9 - 1.f);
+			glm::vec3 camera = center + glm::normalize(direction) * (m.radius * 4.f + 1e-3f);
+			views++;
+			if (!CFR::isMeshletBackfacing(m, createVec3(camera.x, camera.y, camera.z))) continue;
+			culled++;
+			for (CFR::Uint32 t = 0; t < m.triangleCount; t++) {
+				glm::vec3 p[3];
+				for (int k = 0; k < 3; k++) {
+					CFR::Uint32 local = geometry.getMeshletTriangle((m.triangleOffset + t) * 3 + k);
+					CFR::Vec3 v = geometry.getVertex(geometry.getMeshletVertex(m.vertexOffset + local)).position;
+					p[k] = glm::vec3(v.x, v.y, v.z);
+				}
+				glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+				glm::vec3 view = camera - p[0];
+				if (glm::dot(normal, view) > 1e-4f * glm::length(normal) * glm::length(view)) {
+					wrong++;
+					break;
+				}
+			}
+		}
+	}
+	std::cout << count << " meshlets, " << culled << " of " << views << " views culled, " << wrong << " wrong" << std::endl;
+}
+
 Converter::Converter(CFR::Geometry &geometry, CFR::Model &model) : geometry(geometry), model(model) {}
-bool Converter::parse(OBJ::Vertex::Geometry&  v) { report(false); return ElementReader::parse(v); }
-bool Converter::parse(OBJ::Grouping::Groups&   ) { report(false); return true; }
-bool Converter::parse(OBJ::Grouping::Smoothing&) { report(false); return true; }
+bool Converter::parse(OBJ::Grouping::Groups&   ) { return true; }
+bool Converter::parse(OBJ::Grouping::Smoothing&) { return true; }
 bool Converter::parse(OBJ::Triangle &t) {
 	CFR::Vertex a, b, c;
 	a.position = createVec3(t.a.position.x, t.a.position.y, t.a.position.z);
@@ -115,26 +343,84 @@ bool Converter::parse(OBJ::Triangle &t) {
 		std::cout << "Disabling texture coordinates and tangents.\n";
 		geometry.setTypeTexcoord(CFR::TYPE_DISABLE);
 		geometry.setTypeTangent (CFR::TYPE_DISABLE);
-		std::cout << "Recalculating geometry.\n";
-		CFR::size_type count = geometry.getVertexCount();
-		geometry.recalculate();
-		count -= geometry.getVertexCount();
-		std::cout << count << " vertices removed.\n";
+		indexFirst.clear();
+		indexEntries.clear();
+		if (!builder) {
+			std::cout << "Recalculating geometry.\n";
+			CFR::size_type count = geometry.getVertexCount();
+			geometry.recalculate();
+			count -= geometry.getVertexCount();
+			std::cout << count << " vertices removed.\n";
+		}
 	}
 	if (geometry.getTypeTangent() != CFR::TYPE_DISABLE) {
 		addTangent(a, b, c);
 		addTangent(b, c, a);
 		addTangent(c, a, b);
 	}
-	CFR::Uint32 ea = geometry.addVertex(a);
-	CFR::Uint32 eb = geometry.addVertex(b);
-	CFR::Uint32 ec = geometry.addVertex(c);
-	geometry.addElement(ea);
-	geometry.addElement(eb);
-	geometry.addElement(ec);
-	report(false);
+	CFR::Uint32 ea = addVertex(a);
+	CFR::Uint32 eb = addVertex(b);
+	CFR::Uint32 ec = addVertex(c);
+	addElement(ea);
+	addElement(eb);
+	addElement(ec);
 	return true;
 }
+void Converter::triangles(const OBJ::TriangleIndex *t, std::size_t count) {
+	for (std::size_t i = 0; i < count; i++) {
+		if (indexed(t[i])) {
+			bool hasUV = t[i].a.hasTexture && t[i].b.hasTexture && t[i].c.hasTexture;
+			CFR::Uint32 ea = addIndexed(t[i].a, hasUV);
+			CFR::Uint32 eb = addIndexed(t[i].b, hasUV);
+			CFR::Uint32 ec = addIndexed(t[i].c, hasUV);
+			addElement(ea);
+			addElement(eb);
+			addElement(ec);
+		} else {
+			OBJ::Triangle e;
+			resolve(t[i].a, e.a);
+			resolve(t[i].b, e.b);
+			resolve(t[i].c, e.c);
+			if (!Converter::parse(e)) rejectTriangle(i);
+		}
+	}
+}
+bool Converter::indexed(const OBJ::TriangleIndex &t) const {
+	/* Vertices only depend on v/vt/vn without computed tangents or normals.
+	 * Tangents are per face and differ in their last bits between faces, keying on them hardly ever hits. */
+	if (geometry.getTypeTangent() != CFR::TYPE_DISABLE) return false;
+	if (geometry.getTypeNormal() != CFR::TYPE_DISABLE && !(t.a.hasNormal && t.b.hasNormal && t.c.hasNormal)) return false;
+	if (geometry.getTypeTexcoord() != CFR::TYPE_DISABLE && !(t.a.hasTexture && t.b.hasTexture && t.c.hasTexture)) return false;
+	return true;
+}
+CFR::Uint32 Converter::addIndexed(const OBJ::VertexIndex &i, bool hasUV) {
+	static const CFR::Uint32 none = ~CFR::Uint32(0);
+	std::size_t vt = i.hasTexture ? i.texture : ~std::size_t(0);
+	std::size_t vn = i.hasNormal  ? i.normal  : ~std::size_t(0);
+	if (!builder) {
+		if (i.position >= indexFirst.size()) indexFirst.resize(getGeometry().size(), none);
+		for (CFR::Uint32 e = indexFirst[i.position]; e != none; e = indexEntries[e].next) {
+			if (indexEntries[e].vt == vt && indexEntries[e].vn == vn) return indexEntries[e].element;
+		}
+	}
+	OBJ::TriangleVertex t;
+	resolve(i, t);
+	CFR::Vertex v;
+	v.position = createVec3(t.position.x, t.position.y, t.position.z);
+	if (geometry.getTypeNormal() != CFR::TYPE_DISABLE) v.normal = createVec3(t.normal.x, t.normal.y, t.normal.z);
+	if (hasUV) v.texcoord = createVec2(t.texture.x, t.texture.y);
+	IndexEntry entry;
+	entry.vt      = vt;
+	entry.vn      = vn;
+	entry.element = addVertex(v);
+	
+	/* Out-of-core builds don't keep the index, duplicates are merged when finished */
+	if (builder) return entry.element;
+	entry.next    = indexFirst[i.position];
+	indexFirst[i.position] = static_cast<CFR::Uint32>(indexEntries.size());
+	indexEntries.push_back(entry);
+	return entry.element;
+}
 void Converter::addNormal(OBJ::TriangleVertex &a, const OBJ::TriangleVertex &b, const OBJ::TriangleVertex &c) {
 	if (a.hasNormal) return;
 	glm::vec3 va(a.position.x, a.position.y, a.position.z);
@@ -168,12 +454,27 @@ void Converter::addTangent(CFR::Vertex &a, const CFR::Vertex &b, const CFR::Vert
 	a.tangent.z = tangent.z;
 	a.tangent.w = tangent.w;
 }
+CFR::Uint32 Converter::addVertex(const CFR::Vertex &v) {
+	return builder ? builder->addVertex(v) : geometry.addVertex(v);
+}
+void Converter::addElement(CFR::Uint32 element) {
+	if (builder) {
+		builder->addElement(element);
+	} else {
+		geometry.addElement(element);
+	}
+}
+CFR::size_type Converter::getElementCount() const {
+	return builder ? builder->getElementCount() : geometry.getElementCount();
+}
+CFR::size_type Converter::getVertexCount() const {
+	return builder ? builder->getVertexCount() : geometry.getVertexCount();
+}
 bool Converter::parse(OBJ::Render::UseMaterial &m) {
 	if (m.name.compare(lastMaterial) == 0) return true;
 	done();
 	material = materials.find(m.name);
 	lastMaterial = m.name;
-	report(false);
 	return true;
 }
 bool Converter::parse(OBJ::Render::MaterialLib &m) {
@@ -182,7 +483,7 @@ bool Converter::parse(OBJ::Render::MaterialLib &m) {
 	return true;
 }
 void Converter::done() {
-	CFR::size_type currentElements = geometry.getElementCount();
+	CFR::size_type currentElements = getElementCount();
 	if (currentElements - lastElements == 0) return;
 	CFR::ModelObject object;
 	object.start = lastElements;
@@ -197,15 +498,18 @@ void Converter::done() {
 	model.addObject(object);
 	lastElements = currentElements;
 }
+void Converter::progress(std::size_t, std::size_t) {
+	report(false);
+}
 void Converter::report(bool force) {
 	std::time_t now = std::time(nullptr);
 	if (force || now > lastReport) {
 		lastReport = now;
-		float done = (100.f * getLineNumber()) / lines;
+		float done = getBytesTotal() > 0 ? (100.f * getBytesRead()) / getBytesTotal() : 0.f;
 		std::cout << "Progress " << done << "%";
 		std::cout << " Line " << getLineNumber();
-		std::cout << " Elements " << geometry.getElementCount();
-		std::cout << " Vertices " << geometry.getVertexCount();
+		std::cout << " Elements " << getElementCount();
+		std::cout << " Vertices " << getVertexCount();
 		std::cout << std::endl;
 	}
 }
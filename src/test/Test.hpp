@@ -0,0 +1,29 @@
+#pragma once
+#ifndef _TEST_HPP_
+#define _TEST_HPP_
+
+#include <iostream>
+
+/* Failed checks are counted, the first few are reported */
+inline int& testFailures() {
+	static int failures = 0;
+	return failures;
+}
+
+/* Returns ok, reports what failed */
+inline bool check(bool ok, const char *what) {
+	if (!ok && testFailures()++ < 20) std::cerr << "Failed: " << what << std::endl;
+	return ok;
+}
+
+/* Exit code of a test program */
+inline int testResult(const char *name) {
+	if (testFailures() > 0) {
+		std::cerr << name << ": " << testFailures() << " checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << name << ": OK" << std::endl;
+	return 0;
+}
+
+#endif // _TEST_HPP_
@@ -0,0 +1,109 @@
+#include "Test.hpp"
+#include "../Common/ByteScan.hpp"
+#include <vector>
+#include <random>
+
+/*
+	Cross-checks every supported scan level against plain loops. Buffers
+	start at every offset within a vector, so heads and tails are unaligned,
+	and take every length from 0 to 2 AVX2 vectors, then longer ones.
+*/
+
+static const std::size_t vectorSize = 32; // AVX2
+
+inline bool isGraph(char c) {
+	unsigned char u = static_cast<unsigned char>(c);
+	return u > 0x20 && u < 0x7F;
+}
+
+/* Reference results */
+
+const char* refByte(const char *begin, const char *end, char c) {
+	while (begin < end && *begin != c) begin++;
+	return begin;
+}
+
+std::size_t refCount(const char *begin, const char *end, char c) {
+	std::size_t count = 0;
+	for (; begin < end; begin++) count += *begin == c;
+	return count;
+}
+
+const char* refGraph(const char *begin, const char *end, bool graph) {
+	while (begin < end && isGraph(*begin) != graph) begin++;
+	return begin;
+}
+
+const char* refGraphReverse(const char *begin, const char *end) {
+	while (end > begin && !isGraph(end[-1])) end--;
+	return end;
+}
+
+/* Mostly text with runs of separators and some bytes above 0x7F */
+void fill(std::vector<char> &buffer, std::mt19937 &rng) {
+	static const char separators[] = { ' ', '\t', '\n', '\r', '\0', '\x7F', '\x80', '\xFF' };
+	std::uniform_int_distribution<int> kind(0, 9), graph(0x21, 0x7E), separator(0, 7), any(0, 255);
+	for (char &c : buffer) {
+		int k = kind(rng);
+		if      (k < 5) c = static_cast<char>(graph(rng));
+		else if (k < 9) c = separators[separator(rng)];
+		else            c = static_cast<char>(any(rng));
+	}
+}
+
+/* One range at the current level */
+void checkRange(const char *begin, const char *end) {
+	static const char bytes[] = { '\n', ' ', '\0', '\xFF', 'v' };
+	for (char c : bytes) {
+		check(scanByte (begin, end, c) == refByte (begin, end, c), "scanByte");
+		check(countByte(begin, end, c) == refCount(begin, end, c), "countByte");
+	}
+	check(scanGraph       (begin, end) == refGraph(begin, end, true),  "scanGraph");
+	check(scanNonGraph    (begin, end) == refGraph(begin, end, false), "scanNonGraph");
+	check(scanGraphReverse(begin, end) == refGraphReverse(begin, end), "scanGraphReverse");
+}
+
+void checkLevel(ScanLevel level) {
+	std::mt19937 rng(level);
+	std::vector<char> buffer(4 * vectorSize + 4096);
+	
+	/* Every head offset and every length up to two vectors */
+	for (int round = 0; round < 20; round++) {
+		fill(buffer, rng);
+		for (std::size_t offset = 0; offset < vectorSize; offset++) {
+			for (std::size_t length = 0; length <= 2 * vectorSize; length++) {
+				checkRange(buffer.data() + offset, buffer.data() + offset + length);
+			}
+		}
+	}
+	
+	/* Long ranges, and ones of a single repeated byte */
+	std::uniform_int_distribution<std::size_t> offset(0, vectorSize - 1), length(0, 4096);
+	for (int round = 0; round < 200; round++) {
+		fill(buffer, rng);
+		std::size_t first = offset(rng);
+		checkRange(buffer.data() + first, buffer.data() + first + length(rng));
+	}
+	static const char runs[] = { '\n', ' ', 'a' };
+	for (char c : runs) {
+		std::vector<char> run(4096 + vectorSize, c);
+		for (std::size_t first = 0; first < vectorSize; first++) checkRange(run.data() + first, run.data() + run.size());
+	}
+}
+
+int main() {
+	ScanLevel best = getScanLevel();
+	static const ScanLevel levels[] = { SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2 };
+	static const char *names[] = { "scalar", "SSE2", "AVX2" };
+	for (ScanLevel level : levels) {
+		if (!setScanLevel(level)) {
+			std::cout << names[level] << " isn't supported, skipped" << std::endl;
+			continue;
+		}
+		int failures = testFailures();
+		checkLevel(level);
+		std::cout << names[level] << (testFailures() == failures ? " matches" : " differs") << std::endl;
+	}
+	check(setScanLevel(best), "setScanLevel");
+	return testResult("test_bytescan");
+}
@@ -0,0 +1,223 @@
+#include "Test.hpp"
+#include "../Common/CFR/Codec.hpp"
+#include "../Common/CFR/Geometry.hpp"
+#include <vector>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility> // std::swap
+
+/*
+	Round trips triangles through the FIFO coder. Chunks after the first
+	start at a nonzero element, a strip there must code as small as one
+	that starts at 0. Vertices round trip through the byte plane coder at
+	several strides and counts that aren't whole groups.
+	A geometry saved as version 1, loaded and saved as version 2, then
+	loaded and saved as version 1 again gives the first file. Truncated
+	version 2 files and ones with a bit flipped in the header fields or the
+	chunk table fail to load with CFR::Exception. Flips in chunk data can't
+	always be told apart from other data, they load or throw CFR::Exception.
+*/
+
+using namespace CFR;
+
+/* Strip of count triangles over vertices from base, every other one flipped */
+std::vector<Uint32> strip(Uint32 base, size_type count) {
+	std::vector<Uint32> elements;
+	for (Uint32 i = 0; i < count; i++) {
+		Uint32 a = base + i, b = a + 1, c = a + 2;
+		if (i & 1) std::swap(a, b);
+		elements.push_back(a);
+		elements.push_back(b);
+		elements.push_back(c);
+	}
+	return elements;
+}
+
+/* Triangles over random vertices from base */
+std::vector<Uint32> soup(Uint32 base, Uint32 vertices, size_type count, std::mt19937 &rng) {
+	std::uniform_int_distribution<Uint32> vertex(base, base + vertices - 1);
+	std::vector<Uint32> elements(count * 3);
+	for (Uint32 &e : elements) e = vertex(rng);
+	return elements;
+}
+
+/* Returns the coded size */
+size_type roundTrip(const std::vector<Uint32> &elements, const char *what) {
+	std::vector<Uint8> data;
+	encodeTriangles(elements.data(), elements.size(), data);
+	std::vector<Uint32> decoded(elements.size());
+	try {
+		decodeTriangles(data.data(), data.size(), decoded.size(), decoded.data());
+		check(decoded == elements, what);
+	} catch (const Exception&) {
+		check(false, what);
+	}
+	return data.size();
+}
+
+/* Vertices that change slowly, with some noise in the low bytes */
+std::vector<Uint8> vertices(size_type count, size_type stride, std::mt19937 &rng) {
+	std::vector<Uint8> data(count * stride);
+	for (size_type i = 0; i < count; i++) {
+		for (size_type b = 0; b < stride; b++) {
+			Uint8 previous = i > 0 ? data[(i - 1) * stride + b] : Uint8(b * 37);
+			data[i * stride + b] = b % 4 == 0 ? Uint8(rng()) : Uint8(previous + rng() % 3);
+		}
+	}
+	return data;
+}
+
+void vertexRoundTrip(size_type count, size_type stride, std::mt19937 &rng) {
+	std::vector<Uint8> raw = vertices(count, stride, rng);
+	std::vector<Uint8> data;
+	encodeVertices(raw.data(), count, stride, data);
+	std::vector<Uint8> decoded(raw.size());
+	try {
+		decodeVertices(data.data(), data.size(), count, stride, decoded.data());
+		check(decoded == raw, "vertex round trip");
+	} catch (const Exception&) {
+		check(false, "vertex round trip");
+	}
+	if (data.empty()) return;
+	try {
+		decodeVertices(data.data(), data.size() - 1, count, stride, decoded.data());
+		check(false, "truncated vertices throw");
+	} catch (const Exception&) {}
+}
+
+/* Grid of size x size quads, heights and texture coordinates vary */
+Geometry grid(Uint32 size) {
+	Geometry geometry;
+	for (Uint32 y = 0; y <= size; y++) {
+		for (Uint32 x = 0; x <= size; x++) {
+			Vertex v;
+			v.position.x = float(x);
+			v.position.y = 0.1f * float((x * 7 + y * 13) % 17);
+			v.position.z = float(y);
+			v.texcoord.x = float(x) / size;
+			v.texcoord.y = float(y) / size;
+			v.normal.y   = 1.f;
+			v.tangent.x  = 1.f;
+			v.tangent.w  = 1.f;
+			geometry.pushVertex(v);
+		}
+	}
+	for (Uint32 y = 0; y < size; y++) {
+		for (Uint32 x = 0; x < size; x++) {
+			Uint32 a = y * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+			geometry.addElement(a); geometry.addElement(c); geometry.addElement(b);
+			geometry.addElement(b); geometry.addElement(c); geometry.addElement(d);
+		}
+	}
+	return geometry;
+}
+
+std::string save(const Geometry &geometry) {
+	std::ostringstream out(std::ios::out | std::ios::binary);
+	out << geometry;
+	return out.str();
+}
+
+/* Whether the file loads, fails the check if loading throws anything but CFR::Exception */
+bool loads(const std::string &file, Geometry &geometry) {
+	std::istringstream in(file, std::ios::in | std::ios::binary);
+	try {
+		in >> geometry;
+		return true;
+	} catch (const Exception&) {
+		return false;
+	} catch (...) {
+		check(false, "loading throws CFR::Exception only");
+		return false;
+	}
+}
+
+void fileRoundTrip() {
+	
+	/* More than one chunk of vertices and elements */
+	Geometry geometry = grid(260);
+	std::string v1 = save(geometry);
+	Geometry loaded1;
+	if (!check(loads(v1, loaded1), "version 1 loads")) return;
+	check(loaded1.getFileVersion() == 1, "version 1 is kept");
+	loaded1.setFileVersion(2);
+	std::string v2 = save(loaded1);
+	check(v2.size() < v1.size(), "version 2 is smaller");
+	Geometry loaded2;
+	if (!check(loads(v2, loaded2), "version 2 loads")) return;
+	check(loaded2.getFileVersion() == 2, "version 2 is kept");
+	check(save(loaded2) == v2, "version 2 saves the same");
+	loaded2.setFileVersion(1);
+	check(save(loaded2) == v1, "version 1 after version 2 is the same");
+	
+	/* Chunk table after the header and the chunk count */
+	static const size_type headerSize = 32;
+	static const size_type chunkEntry = 24;
+	size_type countChunks = Uint8(v2[headerSize]) | Uint8(v2[headerSize + 1]) << 8;
+	size_type tableEnd = headerSize + 4 + countChunks * chunkEntry;
+	Geometry broken;
+	for (size_type size : { size_type(0), size_type(4), headerSize, headerSize + 4, tableEnd - 1, tableEnd, tableEnd + 1, v2.size() / 2, v2.size() - 1 }) {
+		check(!loads(v2.substr(0, size), broken), "truncated version 2 throws");
+	}
+	
+	/* Header fields other than the attributes and unused bytes, and the chunk table but its unused bytes */
+	for (size_type i = 0; i < tableEnd; i++) {
+		bool attributes = i >= 18 && i < headerSize;
+		bool unused = i >= headerSize + 4 && (i - headerSize - 4) % chunkEntry >= 2 && (i - headerSize - 4) % chunkEntry < 4;
+		if (attributes || unused) continue;
+		std::string file = v2;
+		file[i] ^= 1 << (i % 8);
+		check(!loads(file, broken), "flipped version 2 header or chunk table throws");
+	}
+	
+	/* Chunk data */
+	std::mt19937 rng(5);
+	std::uniform_int_distribution<size_type> byte(tableEnd, v2.size() - 1);
+	for (int n = 0; n < 200; n++) {
+		std::string file = v2;
+		file[byte(rng)] ^= 1 << (rng() % 8);
+		loads(file, broken);
+	}
+}
+
+int main() {
+	
+	static const size_type triangles = 30000;
+	Uint32 bases[] = { 0, 1, 65536, 3 << 16, 0x7FFFFFFF, 0xFFFFFFFF - triangles - 2 };
+	
+	/* Strips code the same at every base, a byte per triangle after the first */
+	size_type sizeZero = roundTrip(strip(0, triangles), "strip round trip");
+	check(sizeZero < triangles + 16, "strip size at base 0");
+	for (Uint32 base : bases) {
+		size_type size = roundTrip(strip(base, triangles), "strip round trip");
+		check(size <= sizeZero + 16, "strip size doesn't depend on the base");
+	}
+	
+	/* Coded by value and from the FIFO */
+	std::mt19937 rng(1);
+	for (Uint32 base : bases) {
+		roundTrip(soup(base, 100,     5000, rng), "small soup round trip");
+		roundTrip(soup(base, 1 << 20, 5000, rng), "large soup round trip");
+	}
+	
+	/* Strips with jumps back and forth between them */
+	std::vector<Uint32> mixed;
+	for (Uint32 base : { 1000u, 0u, 500000u, 2000u, 100u }) {
+		std::vector<Uint32> part = strip(base, 300);
+		mixed.insert(mixed.end(), part.begin(), part.end());
+	}
+	roundTrip(mixed, "mixed strips round trip");
+	roundTrip(std::vector<Uint32>(), "empty round trip");
+	
+	/* Byte planes, counts around whole groups of 16 */
+	for (size_type stride : { 1, 3, 4, 12, 20, 48 }) {
+		for (size_type count : { 0, 1, 15, 16, 17, 33, 1000, 65536 + 5 }) {
+			vertexRoundTrip(count, stride, rng);
+		}
+	}
+	
+	fileRoundTrip();
+	
+	return testResult("test_codec");
+}
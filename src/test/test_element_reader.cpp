@@ -0,0 +1,106 @@
+#include "Test.hpp"
+#include "../Common/OBJ/ElementReader.hpp"
+#include <sstream>
+#include <string>
+#include <set>
+
+/*
+	Triangles rejected by parse(Triangle&) must get their lines reported as
+	invalid in every batch mode, as must faces with bad indices and other
+	invalid lines. The log is the same as without batches, each line once
+	with its text and in line order.
+*/
+
+static const float rejectX = 13.f;
+
+/* Rejects triangles with a vertex at x = 13 */
+struct RejectingReader : public OBJ::ElementReader {
+	std::size_t accepted = 0;
+	bool parse(OBJ::Triangle &t) override {
+		if (t.a.position.x == rejectX || t.b.position.x == rejectX || t.c.position.x == rejectX) return false;
+		accepted++;
+		return true;
+	}
+};
+
+struct Input {
+	std::string text;
+	std::set<std::size_t> invalid; // Line numbers expected in the log
+	std::size_t accepted = 0;
+};
+
+/* Quads, some with a rejected second triangle, triangles, faces with bad indices and invalid lines */
+Input generate() {
+	Input in;
+	std::ostringstream os;
+	std::size_t line = 0;
+	os << "v 0 0 0\nv 1 0 0\nv 1 1 0\nv " << rejectX << " 1 0\n";
+	line += 4;
+	for (std::size_t i = 0; i < 500; i++) {
+		line++;
+		switch (i % 11) {
+		case 0: os << "f 1 2 3 4\n";  in.invalid.insert(line); in.accepted += 1; break; // Second triangle is rejected
+		case 1: os << "f 4 1 2\n";    in.invalid.insert(line); break;
+		case 2: os << "f 1 2 99\n";   in.invalid.insert(line); break;                   // Bad index
+		case 3: os << "v 2 2 2\n";    break;
+		case 4: os << "f 4 1 2 99\n"; in.invalid.insert(line); break;                   // Rejected and bad index
+		case 5: os << "v 2 x 2\n";    in.invalid.insert(line); break;
+		case 6: os << "foo 1 2\n";    in.invalid.insert(line); break;                   // Delivers the batch
+		default: os << "f 1 2 3\n";   in.accepted += 1; break;
+		}
+	}
+	in.text = os.str();
+	return in;
+}
+
+/* Line numbers of "Invalid line N" messages */
+std::multiset<std::size_t> logged(const std::string &log) {
+	std::multiset<std::size_t> lines;
+	static const std::string marker = "Invalid line ";
+	for (std::size_t pos = log.find(marker); pos != std::string::npos; pos = log.find(marker, pos + 1)) {
+		lines.insert(std::stoul(log.substr(pos + marker.size())));
+	}
+	return lines;
+}
+
+std::string readLog(const Input &input, OBJ::TriangleBatch mode, std::size_t size, unsigned threads, bool stream, std::size_t &accepted) {
+	RejectingReader reader;
+	reader.setTriangleBatch(mode, size);
+	reader.setThreads(threads);
+	std::ostringstream log;
+	if (stream) {
+		std::istringstream in(input.text);
+		reader.read(in, log);
+	} else {
+		reader.read(OBJ::Range(input.text), log);
+	}
+	accepted = reader.accepted;
+	return log.str();
+}
+
+int main() {
+	Input input = generate();
+	std::multiset<std::size_t> expected(input.invalid.begin(), input.invalid.end());
+	std::size_t accepted = 0;
+	std::string reference = readLog(input, OBJ::BATCH_NONE, 1, 1, false, accepted);
+	check(logged(reference) == expected, "invalid lines without batches");
+	static const OBJ::TriangleBatch modes[] = { OBJ::BATCH_NONE, OBJ::BATCH_TRIANGLES, OBJ::BATCH_INDICES };
+	static const std::size_t sizes[] = { 1, 3, 4096 };
+	static const unsigned threads[] = { 1, 3 };
+	for (OBJ::TriangleBatch mode : modes) {
+		for (std::size_t size : sizes) {
+			for (unsigned thread : threads) {
+				for (int stream = 0; stream < 2; stream++) {
+					std::string log = readLog(input, mode, size, thread, stream != 0, accepted);
+					bool ok = check(log == reference, "log is the same as without batches");
+					ok = check(accepted == input.accepted, "accepted triangles") && ok;
+					if (!ok) {
+						std::cerr << "  mode " << mode << ", batch " << size << ", threads " << thread
+						          << (stream ? ", stream" : ", range") << std::endl;
+					}
+				}
+			}
+		}
+	}
+	return testResult("test_element_reader");
+}
@@ -0,0 +1,167 @@
+#include "Test.hpp"
+#include "../Common/CFR/Geometry.hpp"
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdint>   // std::int16_t
+#include <algorithm> // std::min, std::max
+
+/*
+	Round trips random tangent frames through the octahedral normal and
+	QTangent types, saved and loaded from both vertex storages. Angular
+	errors stay within the bounds measured for each type, with a little
+	margin, the handedness in the tangent's w survives and saving a loaded
+	geometry again gives the same file. QTangent16 is the exception, there
+	vertices may move by one step, few of them unless the normal is stored too.
+*/
+
+using namespace CFR;
+
+static const std::size_t frames = 100000;
+
+struct Case {
+	const char *name;
+	Uint8 typeNormal;
+	Uint8 typeTangent;
+	double normalBound;  // Degrees
+	double tangentBound; // Degrees, 0 if the tangent isn't encoded
+	double moved;        // Fraction of vertices a re-save may move by a step
+};
+
+/* Largest errors found over 200k frames were 0.63, 0.0025, 1.09 and 0.0036 / 0.0068 degrees.
+ * QTangent16 moved 0.01% of vertices on a re-save. With an octahedral normal the
+ * frame is rebuilt around the decoded normal, which moves far more of them. */
+static const Case cases[] = {
+	{ "oct8",         TYPE_OCT_NORM_BYTE,  TYPE_HALF_FLOAT,           0.7,   0.0,   0.0   },
+	{ "oct16",        TYPE_OCT_NORM_SHORT, TYPE_HALF_FLOAT,           0.003, 0.0,   0.0   },
+	{ "qtangent8",    TYPE_DISABLE,        TYPE_QTANGENT_NORM_BYTE,   1.2,   1.2,   0.0   },
+	{ "qtangent16",   TYPE_DISABLE,        TYPE_QTANGENT_NORM_SHORT,  0.004, 0.008, 0.001 },
+	{ "oct16 qtan16", TYPE_OCT_NORM_SHORT, TYPE_QTANGENT_NORM_SHORT,  0.003, 0.008, 0.5   }
+};
+
+/* Unit normals, the first 6 on the axes, with orthogonal unit tangents of either handedness */
+std::vector<Vertex> generate(std::mt19937 &rng) {
+	std::normal_distribution<float> normal;
+	std::vector<Vertex> vertices(frames);
+	for (std::size_t i = 0; i < frames; i++) {
+		Vertex &v = vertices[i];
+		v.position.x = float(i);
+		float n[3] = { normal(rng), normal(rng), normal(rng) };
+		if (i < 6) {
+			n[0] = n[1] = n[2] = 0.f;
+			n[i % 3] = i < 3 ? 1.f : -1.f;
+		}
+		float l = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		v.normal.x = n[0] / l;
+		v.normal.y = n[1] / l;
+		v.normal.z = n[2] / l;
+		float t[3] = { normal(rng), normal(rng), normal(rng) };
+		float d = t[0] * v.normal.x + t[1] * v.normal.y + t[2] * v.normal.z;
+		t[0] -= d * v.normal.x;
+		t[1] -= d * v.normal.y;
+		t[2] -= d * v.normal.z;
+		l = std::sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+		v.tangent.x = t[0] / l;
+		v.tangent.y = t[1] / l;
+		v.tangent.z = t[2] / l;
+		v.tangent.w = rng() & 1 ? 1.f : -1.f;
+	}
+	return vertices;
+}
+
+/* Degrees between two directions */
+double angle(float ax, float ay, float az, float bx, float by, float bz) {
+	double la = std::sqrt(double(ax) * ax + double(ay) * ay + double(az) * az);
+	double lb = std::sqrt(double(bx) * bx + double(by) * by + double(bz) * bz);
+	double c = (double(ax) * bx + double(ay) * by + double(az) * bz) / (la * lb);
+	c = std::max(-1.0, std::min(1.0, c));
+	return std::acos(c) * 180.0 / 3.14159265358979323846;
+}
+
+std::string save(const Geometry &geometry) {
+	std::ostringstream out(std::ios::out | std::ios::binary);
+	out << geometry;
+	return out.str();
+}
+
+void load(const std::string &file, Geometry &geometry) {
+	std::istringstream in(file, std::ios::in | std::ios::binary);
+	in >> geometry;
+}
+
+/* Vertices of a re-saved file that moved, fails if a short component moved by more than one step */
+std::size_t moved(const std::string &a, const std::string &b, std::size_t headerSize, std::size_t stride) {
+	std::size_t count = 0;
+	for (std::size_t v = 0; v < frames; v++) {
+		std::size_t begin = headerSize + v * stride;
+		if (a.compare(begin, stride, b, begin, stride) == 0) continue;
+		for (std::size_t i = begin; i < begin + stride; i += 2) {
+			int va = std::int16_t(Uint8(a[i]) | Uint8(a[i + 1]) << 8);
+			int vb = std::int16_t(Uint8(b[i]) | Uint8(b[i + 1]) << 8);
+			check(std::abs(va - vb) <= 1, "re-saved component moved by one step at most");
+		}
+		count++;
+	}
+	return count;
+}
+
+void checkCase(const Case &c, const std::vector<Vertex> &vertices, VertexStorage storage) {
+	Geometry geometry;
+	geometry.setTypeNormal(c.typeNormal);
+	geometry.setTypeTangent(c.typeTangent);
+	geometry.setVertexStorage(storage);
+	for (std::size_t i = 0; i < frames; i++) {
+		geometry.pushVertex(vertices[i]);
+		geometry.addElement(Uint32(i));
+	}
+	std::string file = save(geometry);
+	Geometry loaded;
+	load(file, loaded);
+	if (!check(loaded.getVertexCount() == frames, c.name)) return;
+	
+	double normalError = 0.0, tangentError = 0.0;
+	std::size_t handedness = 0;
+	for (std::size_t i = 0; i < frames; i++) {
+		const Vertex &a = vertices[i];
+		Vertex b = loaded.getVertex(i);
+		normalError = std::max(normalError, angle(a.normal.x, a.normal.y, a.normal.z, b.normal.x, b.normal.y, b.normal.z));
+		if (c.tangentBound > 0.0) {
+			tangentError = std::max(tangentError, angle(a.tangent.x, a.tangent.y, a.tangent.z, b.tangent.x, b.tangent.y, b.tangent.z));
+			handedness += b.tangent.w != a.tangent.w;
+		}
+	}
+	std::cout << c.name << (storage == STORAGE_PACKED ? " packed" : " full") << ": normal " << normalError << " deg";
+	if (c.tangentBound > 0.0) std::cout << ", tangent " << tangentError << " deg";
+	std::cout << std::endl;
+	check(normalError  <= c.normalBound,  "normal error within the bound");
+	check(tangentError <= c.tangentBound, "tangent error within the bound");
+	check(handedness == 0, "tangent w is the same sign of one");
+	
+	/* Saving the loaded geometry again */
+	std::string again = save(loaded);
+	if (!check(again.size() == file.size(), "re-saved size")) return;
+	if (c.moved == 0.0) {
+		check(again == file, "re-saved file is the same");
+	} else {
+		std::size_t stride = loaded.getVertexSize();
+		std::size_t vertices = file.size() - frames * 4; // Header and vertices, elements are 32 bits
+		std::size_t count = moved(file, again, vertices - frames * stride, stride);
+		std::cout << c.name << ": re-save moved " << count << " of " << frames << " vertices" << std::endl;
+		check(count <= c.moved * frames, "few re-saved vertices moved");
+		check(file.compare(vertices, std::string::npos, again, vertices, std::string::npos) == 0, "re-saved elements are the same");
+	}
+}
+
+int main() {
+	
+	std::mt19937 rng(7);
+	std::vector<Vertex> vertices = generate(rng);
+	for (const Case &c : cases) {
+		checkCase(c, vertices, STORAGE_FULL);
+		checkCase(c, vertices, STORAGE_PACKED);
+	}
+	
+	return testResult("test_encoding");
+}
@@ -0,0 +1,74 @@
+#include "Test.hpp"
+#include "../Common/CFR/BaseGeometry.hpp"
+#include "../Common/CFR/Optimize.hpp"
+#include <vector>
+#include <random>
+
+/*
+	Simplifies irregular planar grids. Every collapse on a plane costs
+	nothing, so neighbouring vertices collapse in the same pass. All
+	triangles face the same side of the plane, one facing the other way
+	was turned over.
+*/
+
+using namespace CFR;
+
+/* Grid of size x size quads on the plane z = slope * x, corners jittered within the plane */
+void plane(BaseGeometry &geometry, Uint32 size, float jitter, float slope, std::mt19937 &rng) {
+	std::uniform_real_distribution<float> noise(-jitter, jitter);
+	for (Uint32 y = 0; y <= size; y++) {
+		for (Uint32 x = 0; x <= size; x++) {
+			bool border = x == 0 || y == 0 || x == size || y == size;
+			Vertex v;
+			v.position.x = float(x) + (border ? 0.f : noise(rng));
+			v.position.y = float(y) + (border ? 0.f : noise(rng));
+			v.position.z = slope * v.position.x;
+			v.normal.z = 1.f;
+			geometry.pushVertex(v);
+		}
+	}
+	for (Uint32 y = 0; y < size; y++) {
+		for (Uint32 x = 0; x < size; x++) {
+			Uint32 a = y * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+			geometry.addElement(a); geometry.addElement(b); geometry.addElement(d);
+			geometry.addElement(a); geometry.addElement(d); geometry.addElement(c);
+		}
+	}
+}
+
+/* Triangles of elements facing down in x and y, the plane is a height field */
+size_type flipped(const BaseGeometry &geometry, const std::vector<Uint32> &elements) {
+	size_type count = 0;
+	for (size_type i = 0; i + 2 < elements.size(); i += 3) {
+		Vec3 a = geometry.getVertex(elements[i + 0]).position;
+		Vec3 b = geometry.getVertex(elements[i + 1]).position;
+		Vec3 c = geometry.getVertex(elements[i + 2]).position;
+		count += (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x) < 0.f;
+	}
+	return count;
+}
+
+int main() {
+	
+	std::mt19937 rng(3);
+	static const float jitters[] = { 0.1f, 0.2f, 0.3f };
+	static const float slopes[]  = { 0.f, 0.7f };
+	static const size_type targets[] = { 4000, 1000, 200 };
+	for (float jitter : jitters) {
+		for (float slope : slopes) {
+			BaseGeometry geometry;
+			plane(geometry, 60, jitter, slope, rng);
+			std::vector<Uint32> source(geometry.getElementCount());
+			for (size_type i = 0; i < source.size(); i++) source[i] = geometry.getElement(i);
+			check(flipped(geometry, source) == 0, "source faces up");
+			for (size_type target : targets) {
+				std::vector<Uint32> result;
+				simplify(geometry, 0, geometry.getElementCount(), target, result);
+				check(result.size() < source.size(), "triangles removed");
+				check(flipped(geometry, result) == 0, "no triangle turned over");
+			}
+		}
+	}
+	
+	return testResult("test_simplify");
+}